@@ -0,0 +1,26 @@
+from anytree import Node
+
+node_0 = Node("program")
+node_1 = Node("let", parent=node_0)
+node_2 = Node("var: a", parent=node_1)
+node_3 = Node("expr: 1:30 + 0:45", parent=node_1)
+node_4 = Node("frame", parent=node_0)
+node_5 = Node("arg1: v.mp4", parent=node_4)
+node_6 = Node("arg2: 12", parent=node_4)
+node_7 = Node("dest: o.bmp", parent=node_4)
+node_8 = Node("if", parent=node_0)
+node_9 = Node("left: a", parent=node_8)
+node_10 = Node("right: a", parent=node_8)
+node_11 = Node("play", parent=node_8)
+node_12 = Node("arg1: x.mp4", parent=node_11)
+node_13 = Node("arg2: 0:01", parent=node_11)
+node_14 = Node("arg3: 0:02", parent=node_11)
+node_15 = Node("concat", parent=node_0)
+node_16 = Node("arg1: a.mp4", parent=node_15)
+node_17 = Node("arg2: b.mp4", parent=node_15)
+node_18 = Node("dest: c.mp4", parent=node_15)
+node_19 = Node("audio", parent=node_0)
+node_20 = Node("arg1: a.mp4", parent=node_19)
+node_21 = Node("arg2: 0:01", parent=node_19)
+node_22 = Node("arg3: a", parent=node_19)
+node_23 = Node("dest: q.mp3", parent=node_19)
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+//ARENA
+/*
+Bump allocator for data that lives exactly as long as one compilation (the AST: nodes,
+expression tokens and child lists). Memory comes in blocks that double in size, starting at
+FIRST_BLOCK and up to MAX_BLOCK (a bigger request gets a block of its own); an allocation is
+a pointer bump inside the current block. Nothing is freed one by one: every block goes at
+once when the Arena is destroyed.
+
+make<T>(args...) - constructs a T in place in the arena
+slice(items)     - copies a std::vector (e.g. a scratch buffer) into the arena, as a Slice
+
+Since no destructor ever runs, only trivially destructible types go in (static_asserted).
+*/
+
+// Read-only view of count items stored in an Arena
+template <typename T>
+struct Slice {
+    const T* items = nullptr;
+    uint32_t count = 0;
+
+    const T* begin() const { return items; }
+    const T* end() const { return items + count; }
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    const T& operator[](size_t k) const { return items[k]; }
+};
+
+class Arena {
+    static constexpr size_t FIRST_BLOCK = 64 * 1024;
+    static constexpr size_t MAX_BLOCK = 1024 * 1024;
+
+    std::vector<std::unique_ptr<char[]>> blocks;
+    char* cursor = nullptr;
+    char* limit = nullptr;
+    size_t nextBlock = FIRST_BLOCK;
+    size_t used = 0;      // Bytes handed out
+    size_t reserved = 0;  // Bytes of all blocks
+    size_t requests = 0;
+
+    void* grow(size_t size, size_t align) {
+        size_t blockSize = std::max(nextBlock, size + align);
+        blocks.emplace_back(new char[blockSize]);
+        reserved += blockSize;
+        char* block = blocks.back().get();
+        // An oversized block holds only this request, the current one keeps its free space
+        if (blockSize > MAX_BLOCK && cursor) return bump(block, size, align);
+        if (nextBlock < MAX_BLOCK) nextBlock *= 2;
+        cursor = block;
+        limit = block + blockSize;
+        return bump(cursor, size, align);
+    }
+    void* bump(char*& from, size_t size, size_t align) {
+        uintptr_t at = (reinterpret_cast<uintptr_t>(from) + align - 1) & ~static_cast<uintptr_t>(align - 1);
+        from = reinterpret_cast<char*>(at + size);
+        used += size;
+        requests++;
+        return reinterpret_cast<void*>(at);
+    }
+
+public:
+    Arena() = default;
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    void* allocate(size_t size, size_t align) {
+        uintptr_t at = (reinterpret_cast<uintptr_t>(cursor) + align - 1) & ~static_cast<uintptr_t>(align - 1);
+        if (!cursor || at + size > reinterpret_cast<uintptr_t>(limit)) return grow(size, align);
+        return bump(cursor, size, align);
+    }
+    template <typename T, typename... Args>
+    T* make(Args&&... args) {
+        static_assert(std::is_trivially_destructible<T>::value, "Arena never runs destructors");
+        return new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+    }
+    template <typename T>
+    Slice<T> slice(const std::vector<T>& items) {
+        static_assert(std::is_trivially_copyable<T>::value, "Arena copies items bytewise");
+        if (items.empty()) return {};
+        T* copy = static_cast<T*>(allocate(items.size() * sizeof(T), alignof(T)));
+        std::memcpy(static_cast<void*>(copy), items.data(), items.size() * sizeof(T));
+        return { copy, static_cast<uint32_t>(items.size()) };
+    }
+
+    size_t allocations() const {
+        return requests;
+    }
+    size_t bytesUsed() const {
+        return used;
+    }
+    size_t bytesReserved() const {
+        return reserved;
+    }
+    size_t blockCount() const {
+        return blocks.size();
+    }
+};
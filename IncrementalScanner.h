@@ -0,0 +1,159 @@
+#pragma once
+
+#include "Scanner.h"
+
+//INCREMENTAL RE-LEXING
+/*
+After an edit, relex() updates the tokens and errors of the previous tokenize() instead of
+scanning the whole script again:
+
+1. Scanning restarts at the last token that starts before the first edit (a token always
+   starts outside of comments and strings, so the Lexer can begin there in NORMAL state).
+2. It goes on past the end of the edited text until it produces a token that starts at the
+   same place (shifted by the size change) as an old token. From a token start the rest of
+   the text is identical, so every following old token is still right.
+3. The fresh tokens replace the old ones in between, in place (only a difference in count
+   moves the tail of the list), and the old tokens/errors after that point get their
+   offsets shifted.
+
+Several edits are handled as one damaged range, from the first edit to the end of the last.
+When the error limit of the options is (or would be) reached, the whole text is scanned
+again, since the errors past the limit are only counted.
+Token values are re-pointed into the new text, in the same pass as the shift: one pass over
+the old tokens but no scanning (the fresh ones already point into it).
+*/
+
+struct TextEdit {
+    uint32_t offset;   // In the text before any of the edits
+    uint32_t removed;  // Bytes removed at offset
+    std::string inserted;
+};
+
+// Which part of the token list was replaced: [firstToken, firstToken + inserted) is new
+struct RelexResult {
+    size_t firstToken;
+    size_t removed;
+    size_t inserted;
+};
+
+// Applies non-overlapping edits whose offsets refer to source
+std::string applyEdits(std::string_view source, std::vector<TextEdit> edits) {
+    std::sort(edits.begin(), edits.end(), [](const TextEdit& a, const TextEdit& b) { return a.offset < b.offset; });
+    std::string result;
+    size_t from = 0;
+    for (const TextEdit& edit : edits) {
+        result.append(source.substr(from, edit.offset - from));
+        result.append(edit.inserted);
+        from = edit.offset + edit.removed;
+    }
+    result.append(source.substr(std::min(from, source.size())));
+    return result;
+}
+
+// Points the value of a token at the same lexeme in source (keywords and operators use static text)
+void rebaseToken(Token& token, std::string_view source) {
+    switch (token.type) {
+    case TokenType::ID:
+    case TokenType::INT:
+        token.value = source.substr(token.offset, token.value.size());
+        break;
+    case TokenType::STRING:
+    case TokenType::TIME:
+        token.value = source.substr(token.offset + 1, token.value.size());
+        break;
+    default:
+        break;
+    }
+}
+
+// Scans the whole text again
+RelexResult rescan(std::string_view source, std::vector<Token>& tokens, std::vector<ScannerError>& errors,
+    const ScanOptions& options) {
+    size_t removed = tokens.size();
+    errors.clear();
+    Lexer lexer(source, errors);
+    lexer.setOptions(options);
+    tokens = tokenize(lexer);
+    return { 0, removed, tokens.size() };
+}
+
+// tokens/errors come from tokenize() of the old text with the same options; newSource is that
+// text with edits applied
+RelexResult relex(std::string_view newSource, const std::vector<TextEdit>& edits,
+    std::vector<Token>& tokens, std::vector<ScannerError>& errors, const ScanOptions& options = {}) {
+    // The old scan hit the limit when its list is full: limit errors and the TooManyErrors summary
+    bool limited = errors.size() > options.errorLimit;
+    if (tokens.empty() || limited) return rescan(newSource, tokens, errors, options);
+    if (edits.empty()) {
+        for (Token& token : tokens) rebaseToken(token, newSource);
+        return { 0, 0, 0 };
+    }
+
+    uint32_t editStart = edits[0].offset;
+    uint32_t editEnd = 0;
+    int64_t delta = 0;
+    for (const TextEdit& edit : edits) {
+        editStart = std::min(editStart, edit.offset);
+        editEnd = std::max(editEnd, edit.offset + edit.removed);
+        delta += static_cast<int64_t>(edit.inserted.size()) - edit.removed;
+    }
+    uint32_t newEditEnd = static_cast<uint32_t>(editEnd + delta);
+
+    auto byOffset = [](const Token& token, uint32_t offset) { return token.offset < offset; };
+    size_t first = std::lower_bound(tokens.begin(), tokens.end(), editStart, byOffset) - tokens.begin();
+    uint32_t restart = 0;
+    if (first > 0) restart = tokens[--first].offset;
+
+    std::vector<Token> fresh;
+    std::vector<ScannerError> freshErrors;
+    Lexer lexer(newSource, restart, std::string::npos, ScanState::NORMAL, freshErrors);
+    lexer.setOptions(options);
+    lexer.setErrorLimit(SIZE_MAX);
+    size_t resync = tokens.size();
+    size_t candidate = first;
+    while (true) {
+        Token token = lexer.gettoken();
+        if (token.offset >= newEditEnd) {
+            uint32_t oldOffset = static_cast<uint32_t>(token.offset - delta);
+            while (candidate < tokens.size() && tokens[candidate].offset < oldOffset) candidate++;
+            if (candidate < tokens.size() && tokens[candidate].offset == oldOffset && tokens[candidate].type == token.type) {
+                resync = candidate;
+                // A string comes back with its own errors (InvalidUtf8), the old ones are kept instead
+                while (!freshErrors.empty() && freshErrors.back().offset >= token.offset) freshErrors.pop_back();
+                break;
+            }
+        }
+        fresh.push_back(token);
+        if (lexer.done()) break;
+    }
+
+    // Errors are in offset order: keep the ones before restart, shift the ones after the resync point
+    uint32_t resyncOffset = resync < tokens.size() ? tokens[resync].offset : UINT32_MAX;
+    std::vector<ScannerError> merged;
+    for (ScannerError& err : errors) {
+        if (err.offset < restart) merged.push_back(std::move(err));
+    }
+    for (ScannerError& err : freshErrors) merged.push_back(std::move(err));
+    for (ScannerError& err : errors) {
+        if (err.offset >= restart && err.offset >= resyncOffset) {
+            err.offset = static_cast<uint32_t>(err.offset + delta);
+            merged.push_back(std::move(err));
+        }
+    }
+    if (merged.size() > options.errorLimit) return rescan(newSource, tokens, errors, options);
+    errors.swap(merged);
+
+    // Overwrite the replaced tokens, then insert or erase only the difference
+    size_t removed = resync - first;
+    size_t common = std::min(removed, fresh.size());
+    std::copy(fresh.begin(), fresh.begin() + common, tokens.begin() + first);
+    if (fresh.size() > removed) tokens.insert(tokens.begin() + resync, fresh.begin() + common, fresh.end());
+    else tokens.erase(tokens.begin() + first + common, tokens.begin() + resync);
+
+    for (size_t k = 0; k < first; k++) rebaseToken(tokens[k], newSource);
+    for (size_t k = first + fresh.size(); k < tokens.size(); k++) {
+        tokens[k].offset = static_cast<uint32_t>(tokens[k].offset + delta);
+        rebaseToken(tokens[k], newSource);
+    }
+    return { first, removed, fresh.size() };
+}
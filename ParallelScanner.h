@@ -0,0 +1,132 @@
+#pragma once
+
+#include "Scanner.h"
+#include <thread>
+#include <atomic>
+
+//PARALLEL SCANNER
+/*
+tokenizeParallel() gives exactly the tokens and errors of tokenize(), in the same order,
+using several threads on big in-memory (or mapped) sources.
+
+1. The source is cut into chunks that end right after a '\n', so no token, "##" or
+   "#" comment is split by a boundary; only a ## comment or a string can cross one.
+2. Each chunk is pre-scanned (in parallel) from every ScanState, looking only at '#',
+   '"' and '\n', which gives the state it leaves the scanner in for each entry state.
+3. Chaining those results from the start of the file gives the real entry state of
+   every chunk.
+4. Each chunk is lexed (in parallel) by a Lexer that skips the rest of a carried-over
+   comment/string and stops at the first token starting in the next chunk. A token or
+   comment that crosses the boundary belongs to the chunk where it starts.
+5. The per-chunk tokens and errors are concatenated in chunk order, and the error limit
+   of options is applied to the whole list.
+*/
+
+// Runs body(0..count-1) on up to `threads` worker threads
+template <typename Body>
+void parallelFor(size_t count, unsigned threads, Body body) {
+    std::atomic<size_t> nextIndex{ 0 };
+    auto worker = [&] {
+        for (size_t k = nextIndex++; k < count; k = nextIndex++) body(k);
+    };
+    std::vector<std::thread> pool;
+    for (unsigned t = 1; t < threads && t < count; t++) pool.emplace_back(worker);
+    worker();
+    for (auto& thread : pool) thread.join();
+}
+
+// State the scanner is in at the end of text when it enters it in `state`
+ScanState scanStateAfter(std::string_view text, ScanState state) {
+    const char* p = text.data();
+    size_t n = text.size();
+    size_t i = 0;
+    while (i < n) {
+        if (state == ScanState::BLOCK_COMMENT) {
+            size_t k = scan::findPair(p + i, n - i, '#');
+            if (k == n - i) return state;
+            i += k + 2;
+            state = ScanState::NORMAL;
+        }
+        else if (state == ScanState::STRING) {
+            size_t k = scan::findByte(p + i, n - i, '"');
+            if (k == n - i) return state;
+            i += k + 1;
+            state = ScanState::NORMAL;
+        }
+        else {
+            i += scan::findEither(p + i, n - i, '#', '"');
+            if (i == n) break;
+            if (p[i] == '"') {
+                state = ScanState::STRING;
+                i++;
+            }
+            else if (i + 1 < n && p[i + 1] == '#') {
+                state = ScanState::BLOCK_COMMENT;
+                i += 2;
+            }
+            else {
+                i += scan::findByte(p + i, n - i, '\n');
+            }
+        }
+    }
+    return state;
+}
+
+std::vector<Token> tokenizeParallel(std::string_view source, std::vector<ScannerError>& errors,
+    unsigned threads = 0, size_t chunkSize = 4 * 1024 * 1024, const ScanOptions& options = {}) {
+    if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+
+    std::vector<size_t> bounds{ 0 };
+    while (bounds.back() + chunkSize < source.size()) {
+        size_t from = bounds.back() + chunkSize;
+        size_t newline = scan::findByte(source.data() + from, source.size() - from, '\n');
+        if (from + newline >= source.size() - 1) break;
+        bounds.push_back(from + newline + 1);
+    }
+    bounds.push_back(source.size());
+    size_t chunks = bounds.size() - 1;
+    // (A script too long for 32-bit offsets gets its one SourceTooLarge error from a single lexer)
+    if (chunks == 1 || threads == 1 || source.size() > Lexer::MAX_SOURCE_SIZE) {
+        Lexer lexer(source, errors);
+        lexer.setOptions(options);
+        return tokenize(lexer);
+    }
+
+    const int STATES = 3;
+    std::vector<ScanState> exits(chunks * STATES);
+    parallelFor(chunks, threads, [&](size_t k) {
+        std::string_view text = source.substr(bounds[k], bounds[k + 1] - bounds[k]);
+        for (int s = 0; s < STATES; s++) exits[k * STATES + s] = scanStateAfter(text, static_cast<ScanState>(s));
+    });
+    std::vector<ScanState> entries(chunks, ScanState::NORMAL);
+    for (size_t k = 1; k < chunks; k++) entries[k] = exits[(k - 1) * STATES + static_cast<int>(entries[k - 1])];
+
+    std::vector<std::vector<Token>> chunkTokens(chunks);
+    std::vector<std::vector<ScannerError>> chunkErrors(chunks);
+    parallelFor(chunks, threads, [&](size_t k) {
+        bool last = k + 1 == chunks;
+        Lexer lexer(source, bounds[k], last ? std::string::npos : bounds[k + 1], entries[k], chunkErrors[k]);
+        lexer.setOptions(options);
+        lexer.setErrorLimit(SIZE_MAX);
+        chunkTokens[k] = tokenize(lexer);
+        if (!last) chunkTokens[k].pop_back(); // Stop marker, not the end of the program
+    });
+
+    size_t total = 0;
+    for (const auto& part : chunkTokens) total += part.size();
+    std::vector<Token> tokens;
+    tokens.reserve(total);
+    size_t firstError = errors.size();
+    for (size_t k = 0; k < chunks; k++) {
+        tokens.insert(tokens.end(), chunkTokens[k].begin(), chunkTokens[k].end());
+        errors.insert(errors.end(), chunkErrors[k].begin(), chunkErrors[k].end());
+    }
+    size_t found = errors.size() - firstError;
+    if (found > options.errorLimit) {
+        size_t kept = firstError + options.errorLimit;
+        ScannerError summary = tooManyErrors(errors[kept].offset, found - options.errorLimit, options.errorLimit);
+        errors.resize(kept);
+        errors.push_back(summary);
+    }
+    return tokens;
+}
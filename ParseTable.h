@@ -0,0 +1,216 @@
+#pragma once
+
+#include "Scanner.h"
+
+//PARSE TABLE
+/*
+Generated by ParseTableGenerator from GRAMATICA.txt, do not edit: change the grammar
+and run the generator again (see ParseTableGenerator.cpp).
+
+ 0  program -> statement program
+ 1  program -> ''
+ 2  statement -> assign
+ 3  statement -> command
+ 4  statement -> if_stmt
+ 5  assign -> let ID = expression ;
+ 6  command -> extract_frame
+ 7  command -> concatenate
+ 8  command -> extract_audio
+ 9  command -> play
+10  extract_frame -> frame expression expression to string ;
+11  concatenate -> concat expression expression to string ;
+12  extract_audio -> audio expression expression expression to string ;
+13  play -> 'play' expression play_args
+14  play_args -> ;
+15  play_args -> expression expression ;
+16  if_stmt -> if condition then statement
+17  condition -> expression == expression
+18  expression -> product expression'
+19  expression' -> + product expression'
+20  expression' -> ''
+21  product -> term product'
+22  product' -> * term product'
+23  product' -> ''
+24  term -> number
+25  term -> string
+26  term -> time
+27  term -> ID
+28  term -> ( expression )
+
+program
+    FIRST  { let frame concat audio 'play' if '' }
+    FOLLOW { $ }
+statement
+    FIRST  { let frame concat audio 'play' if }
+    FOLLOW { $ let frame concat audio 'play' if }
+assign
+    FIRST  { let }
+    FOLLOW { $ let frame concat audio 'play' if }
+command
+    FIRST  { frame concat audio 'play' }
+    FOLLOW { $ let frame concat audio 'play' if }
+extract_frame
+    FIRST  { frame }
+    FOLLOW { $ let frame concat audio 'play' if }
+concatenate
+    FIRST  { concat }
+    FOLLOW { $ let frame concat audio 'play' if }
+extract_audio
+    FIRST  { audio }
+    FOLLOW { $ let frame concat audio 'play' if }
+play
+    FIRST  { 'play' }
+    FOLLOW { $ let frame concat audio 'play' if }
+play_args
+    FIRST  { ID ; string number time ( }
+    FOLLOW { $ let frame concat audio 'play' if }
+if_stmt
+    FIRST  { if }
+    FOLLOW { $ let frame concat audio 'play' if }
+condition
+    FIRST  { ID string number time ( }
+    FOLLOW { then }
+expression
+    FIRST  { ID string number time ( }
+    FOLLOW { ID ; to string then == number time ( ) }
+expression'
+    FIRST  { + '' }
+    FOLLOW { ID ; to string then == number time ( ) }
+product
+    FIRST  { ID string number time ( }
+    FOLLOW { ID ; to string then == + number time ( ) }
+product'
+    FIRST  { * '' }
+    FOLLOW { ID ; to string then == + number time ( ) }
+term
+    FIRST  { ID string number time ( }
+    FOLLOW { ID ; to string then == + * number time ( ) }
+*/
+namespace grammar {
+
+// Terminals (0..19), then rules
+enum Symbol : uint16_t {
+    EOP, // $
+    LET, // let
+    ID, // ID
+    ASSIGN_OP, // =
+    SEMICOLON, // ;
+    FRAME_KEY, // frame
+    TO, // to
+    STRING, // string
+    CONCAT_KEY, // concat
+    AUDIO_KEY, // audio
+    PLAY_KEY, // 'play'
+    IF, // if
+    THEN, // then
+    EQUALS, // ==
+    ADD_OP, // +
+    MUL_OP, // *
+    INT, // number
+    TIME, // time
+    OPEN_PAR, // (
+    CLOSE_PAR, // )
+    PROGRAM,
+    STATEMENT,
+    ASSIGN,
+    COMMAND,
+    EXTRACT_FRAME,
+    CONCATENATE,
+    EXTRACT_AUDIO,
+    PLAY,
+    PLAY_ARGS,
+    IF_STMT,
+    CONDITION,
+    EXPRESSION,
+    EXPRESSION_TAIL,
+    PRODUCT,
+    PRODUCT_TAIL,
+    TERM,
+    SYMBOL_COUNT
+};
+const uint16_t TERMINAL_COUNT = 20;
+const uint16_t START = PROGRAM;
+const uint16_t NO_TERMINAL = SYMBOL_COUNT; // A token the grammar doesn't use
+const uint8_t NO_PRODUCTION = 0xFF;
+
+// Token type of each terminal
+constexpr TokenType TERMINAL_TYPES[TERMINAL_COUNT] = {
+    TokenType::EOP, TokenType::LET, TokenType::ID, TokenType::ASSIGN_OP, TokenType::SEMICOLON, TokenType::FRAME_KEY,
+    TokenType::TO, TokenType::STRING, TokenType::CONCAT_KEY, TokenType::AUDIO_KEY, TokenType::PLAY_KEY, TokenType::IF,
+    TokenType::THEN, TokenType::EQUALS, TokenType::ADD_OP, TokenType::MUL_OP, TokenType::INT, TokenType::TIME,
+    TokenType::OPEN_PAR, TokenType::CLOSE_PAR,
+};
+
+// tail: the last symbol is the rule itself (a loop, see Parser::parseProgram)
+struct Production {
+    uint16_t head;
+    uint8_t length;
+    bool tail;
+    uint16_t symbols[7];
+};
+constexpr Production PRODUCTIONS[] = {
+    { PROGRAM, 2, true, { STATEMENT, PROGRAM } },
+    { PROGRAM, 0, false, {} },
+    { STATEMENT, 1, false, { ASSIGN } },
+    { STATEMENT, 1, false, { COMMAND } },
+    { STATEMENT, 1, false, { IF_STMT } },
+    { ASSIGN, 5, false, { LET, ID, ASSIGN_OP, EXPRESSION, SEMICOLON } },
+    { COMMAND, 1, false, { EXTRACT_FRAME } },
+    { COMMAND, 1, false, { CONCATENATE } },
+    { COMMAND, 1, false, { EXTRACT_AUDIO } },
+    { COMMAND, 1, false, { PLAY } },
+    { EXTRACT_FRAME, 6, false, { FRAME_KEY, EXPRESSION, EXPRESSION, TO, STRING, SEMICOLON } },
+    { CONCATENATE, 6, false, { CONCAT_KEY, EXPRESSION, EXPRESSION, TO, STRING, SEMICOLON } },
+    { EXTRACT_AUDIO, 7, false, { AUDIO_KEY, EXPRESSION, EXPRESSION, EXPRESSION, TO, STRING, SEMICOLON } },
+    { PLAY, 3, false, { PLAY_KEY, EXPRESSION, PLAY_ARGS } },
+    { PLAY_ARGS, 1, false, { SEMICOLON } },
+    { PLAY_ARGS, 3, false, { EXPRESSION, EXPRESSION, SEMICOLON } },
+    { IF_STMT, 4, false, { IF, CONDITION, THEN, STATEMENT } },
+    { CONDITION, 3, false, { EXPRESSION, EQUALS, EXPRESSION } },
+    { EXPRESSION, 2, false, { PRODUCT, EXPRESSION_TAIL } },
+    { EXPRESSION_TAIL, 3, true, { ADD_OP, PRODUCT, EXPRESSION_TAIL } },
+    { EXPRESSION_TAIL, 0, false, {} },
+    { PRODUCT, 2, false, { TERM, PRODUCT_TAIL } },
+    { PRODUCT_TAIL, 3, true, { MUL_OP, TERM, PRODUCT_TAIL } },
+    { PRODUCT_TAIL, 0, false, {} },
+    { TERM, 1, false, { INT } },
+    { TERM, 1, false, { STRING } },
+    { TERM, 1, false, { TIME } },
+    { TERM, 1, false, { ID } },
+    { TERM, 3, false, { OPEN_PAR, EXPRESSION, CLOSE_PAR } },
+};
+
+// Production to expand a rule with on each terminal
+const uint8_t TABLE[SYMBOL_COUNT - TERMINAL_COUNT][TERMINAL_COUNT] = {
+    { 1, 0, NO_PRODUCTION, NO_PRODUCTION, NO_PRODUCTION, 0, NO_PRODUCTION, NO_PRODUCTION, 0, 0, 0, 0, NO_PRODUCTION, NO_PRODUCTION, NO_PRODUCTION, NO_PRODUCTION, NO_PRODUCTION, NO_PRODUCTION, NO_PRODUCTION, NO_PRODUCTION }, // program
+    { NO_PRODUCTION, 2, NO_PRODUCTION, NO_PRODUCTION, NO_PRODUCTION, 3, NO_PRODUCTION, NO_PRODUCTION, 3, 3, 3, 4, NO_PRODUCTION, NO_PRODUCTION, NO_PRODUCTION, NO_PRODUCTION, NO_PRODUCTION, NO_PRODUCTION, NO_PRODUCTION, NO_PRODUCTION }, // statement
+    { NO_PRODUCTION, 5, NO_PRODUCTION, NO_PRODUCTION, NO_PRODUCTION, NO_PRODUCTION, NO_PRODUCTION, NO_PRODUCTION, NO_PRODUCTION, NO_PRODUCTION, NO_PRODUCTION, NO_PRODUCTION, NO_PRODUCTION, NO_PRODUCTION, NO_PRODUCTION, NO_PRODUCTION, NO_PRODUCTION, NO_PRODUCTION, NO_PRODUCTION, NO_PRODUCTION }, // assign
+    { NO_PRODUCTION, NO_PRODUCTION, NO_PRODUCTION, NO_PRODUCTION, NO_PRODUCTION, 6, NO_PRODUCTION, NO_PRODUCTION, 7, 8, 9, NO_PRODUCTION, NO_PRODUCTION, NO_PRODUCTION, NO_PRODUCTION, NO_PRODUCTION, NO_PRODUCTION, NO_PRODUCTION, NO_PRODUCTION, NO_PRODUCTION }, // command
+    { NO_PRODUCTION, NO_PRODUCTION, NO_PRODUCTION, NO_PRODUCTION, NO_PRODUCTION, 10, NO_PRODUCTION, NO_PRODUCTION, NO_PRODUCTION, NO_PRODUCTION, NO_PRODUCTION, NO_PRODUCTION, NO_PRODUCTION, NO_PRODUCTION, NO_PRODUCTION, NO_PRODUCTION, NO_PRODUCTION, NO_PRODUCTION, NO_PRODUCTION, NO_PRODUCTION }, // extract_frame
+    { NO_PRODUCTION, NO_PRODUCTION, NO_PRODUCTION, NO_PRODUCTION, NO_PRODUCTION, NO_PRODUCTION, NO_PRODUCTION, NO_PRODUCTION, 11, NO_PRODUCTION, NO_PRODUCTION, NO_PRODUCTION, NO_PRODUCTION, NO_PRODUCTION, NO_PRODUCTION, NO_PRODUCTION, NO_PRODUCTION, NO_PRODUCTION, NO_PRODUCTION, NO_PRODUCTION }, // concatenate
+    { NO_PRODUCTION, NO_PRODUCTION, NO_PRODUCTION, NO_PRODUCTION, NO_PRODUCTION, NO_PRODUCTION, NO_PRODUCTION, NO_PRODUCTION, NO_PRODUCTION, 12, NO_PRODUCTION, NO_PRODUCTION, NO_PRODUCTION, NO_PRODUCTION, NO_PRODUCTION, NO_PRODUCTION, NO_PRODUCTION, NO_PRODUCTION, NO_PRODUCTION, NO_PRODUCTION }, // extract_audio
+    { NO_PRODUCTION, NO_PRODUCTION, NO_PRODUCTION, NO_PRODUCTION, NO_PRODUCTION, NO_PRODUCTION, NO_PRODUCTION, NO_PRODUCTION, NO_PRODUCTION, NO_PRODUCTION, 13, NO_PRODUCTION, NO_PRODUCTION, NO_PRODUCTION, NO_PRODUCTION, NO_PRODUCTION, NO_PRODUCTION, NO_PRODUCTION, NO_PRODUCTION, NO_PRODUCTION }, // play
+    { NO_PRODUCTION, NO_PRODUCTION, 15, NO_PRODUCTION, 14, NO_PRODUCTION, NO_PRODUCTION, 15, NO_PRODUCTION, NO_PRODUCTION, NO_PRODUCTION, NO_PRODUCTION, NO_PRODUCTION, NO_PRODUCTION, NO_PRODUCTION, NO_PRODUCTION, 15, 15, 15, NO_PRODUCTION }, // play_args
+    { NO_PRODUCTION, NO_PRODUCTION, NO_PRODUCTION, NO_PRODUCTION, NO_PRODUCTION, NO_PRODUCTION, NO_PRODUCTION, NO_PRODUCTION, NO_PRODUCTION, NO_PRODUCTION, NO_PRODUCTION, 16, NO_PRODUCTION, NO_PRODUCTION, NO_PRODUCTION, NO_PRODUCTION, NO_PRODUCTION, NO_PRODUCTION, NO_PRODUCTION, NO_PRODUCTION }, // if_stmt
+    { NO_PRODUCTION, NO_PRODUCTION, 17, NO_PRODUCTION, NO_PRODUCTION, NO_PRODUCTION, NO_PRODUCTION, 17, NO_PRODUCTION, NO_PRODUCTION, NO_PRODUCTION, NO_PRODUCTION, NO_PRODUCTION, NO_PRODUCTION, NO_PRODUCTION, NO_PRODUCTION, 17, 17, 17, NO_PRODUCTION }, // condition
+    { NO_PRODUCTION, NO_PRODUCTION, 18, NO_PRODUCTION, NO_PRODUCTION, NO_PRODUCTION, NO_PRODUCTION, 18, NO_PRODUCTION, NO_PRODUCTION, NO_PRODUCTION, NO_PRODUCTION, NO_PRODUCTION, NO_PRODUCTION, NO_PRODUCTION, NO_PRODUCTION, 18, 18, 18, NO_PRODUCTION }, // expression
+    { NO_PRODUCTION, NO_PRODUCTION, 20, NO_PRODUCTION, 20, NO_PRODUCTION, 20, 20, NO_PRODUCTION, NO_PRODUCTION, NO_PRODUCTION, NO_PRODUCTION, 20, 20, 19, NO_PRODUCTION, 20, 20, 20, 20 }, // expression'
+    { NO_PRODUCTION, NO_PRODUCTION, 21, NO_PRODUCTION, NO_PRODUCTION, NO_PRODUCTION, NO_PRODUCTION, 21, NO_PRODUCTION, NO_PRODUCTION, NO_PRODUCTION, NO_PRODUCTION, NO_PRODUCTION, NO_PRODUCTION, NO_PRODUCTION, NO_PRODUCTION, 21, 21, 21, NO_PRODUCTION }, // product
+    { NO_PRODUCTION, NO_PRODUCTION, 23, NO_PRODUCTION, 23, NO_PRODUCTION, 23, 23, NO_PRODUCTION, NO_PRODUCTION, NO_PRODUCTION, NO_PRODUCTION, 23, 23, 23, 22, 23, 23, 23, 23 }, // product'
+    { NO_PRODUCTION, NO_PRODUCTION, 27, NO_PRODUCTION, NO_PRODUCTION, NO_PRODUCTION, NO_PRODUCTION, 25, NO_PRODUCTION, NO_PRODUCTION, NO_PRODUCTION, NO_PRODUCTION, NO_PRODUCTION, NO_PRODUCTION, NO_PRODUCTION, NO_PRODUCTION, 24, 26, 28, NO_PRODUCTION }, // term
+};
+
+// Terminal of each token type (every reserved word has its own), NO_TERMINAL for the rest
+constexpr std::array<uint16_t, static_cast<size_t>(TokenType::END)> buildTerminalOf() {
+    std::array<uint16_t, static_cast<size_t>(TokenType::END)> table{};
+    for (uint16_t& terminal : table) terminal = NO_TERMINAL;
+    for (uint16_t k = 0; k < TERMINAL_COUNT; k++) table[static_cast<size_t>(TERMINAL_TYPES[k])] = k;
+    return table;
+}
+constexpr auto TERMINAL_OF = buildTerminalOf();
+
+uint16_t terminalOf(const Token& token) {
+    return TERMINAL_OF[static_cast<size_t>(token.type)];
+}
+
+}
@@ -0,0 +1,485 @@
+#include "Scanner.h"
+#include <cctype>
+#include <map>
+#include <set>
+#include <sstream>
+
+//PARSE TABLE GENERATOR
+/*
+Build: g++ -std=c++17 -O2 ParseTableGenerator.cpp -o ParseTableGenerator  (or cl /O2 /std:c++17 /EHsc)
+Run:   ParseTableGenerator GRAMATICA.txt ParseTable.h
+Check: ParseTableGenerator --check GRAMATICA.txt ParseTable.h
+
+Reads the grammar, computes FIRST and FOLLOW, checks that it is LL(1) and writes the
+predictive parse table the Parser runs on. Run it again after every grammar change; with
+--check nothing is written, and it fails when the header is not what the grammar gives (a
+grammar edited without running the generator, or a hand-edited table).
+
+Grammar format: "name -> symbols | symbols", an alternative per line may also start with "|",
+'' is the empty alternative. The first rule is the start symbol. The rules of string, number,
+time and ID describe lexemes: they are dropped and those names are terminals (STRING, INT,
+TIME and ID tokens). Any other symbol that is not a rule must be a fixed lexeme of the token
+specification in Scanner.h ("let", "==", ...); "$" is the end of the input. A lexeme in
+quotes ('play') is always a terminal, for keywords spelled like a rule. Rules that the start
+symbol can't reach are left out.
+
+Nothing is written when the grammar is not LL(1) (every conflict is listed instead), when
+a rule derives no input at all, as a left recursive one does, or when it has more
+productions than TABLE can number.
+*/
+
+struct Rule {
+    std::string lhs;
+    std::vector<std::string> rhs;
+};
+
+struct TerminalSpec {
+    std::string spelling; // As in the grammar
+    std::string name;     // Enumerator in the generated header
+    TokenType type;
+};
+
+const std::set<std::string> LEXEME_RULES = { "string", "number", "time", "ID" };
+
+std::vector<std::string> split(const std::string& text) {
+    std::vector<std::string> words;
+    std::stringstream in(text);
+    std::string word;
+    while (in >> word) words.push_back(word);
+    return words;
+}
+
+// Rules in file order, one per alternative
+bool readGrammar(const std::string& path, std::vector<Rule>& rules) {
+    std::ifstream file(path);
+    if (!file) {
+        std::cerr << "Can't open " << path << "\n";
+        return false;
+    }
+    std::string line;
+    std::string lhs;
+    int number = 0;
+    while (std::getline(file, line)) {
+        number++;
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        std::string body;
+        size_t arrow = line.find("->");
+        if (arrow != std::string::npos) {
+            std::vector<std::string> head = split(line.substr(0, arrow));
+            if (head.size() != 1) {
+                std::cerr << path << ":" << number << ": expected one name before ->\n";
+                return false;
+            }
+            lhs = head[0];
+            body = line.substr(arrow + 2);
+        }
+        else {
+            std::vector<std::string> words = split(line);
+            if (words.empty()) continue;
+            if (words[0] != "|" || lhs.empty()) {
+                std::cerr << path << ":" << number << ": expected a rule or an alternative\n";
+                return false;
+            }
+            body = line.substr(line.find('|') + 1);
+        }
+        std::stringstream alternatives(body);
+        std::string alternative;
+        while (std::getline(alternatives, alternative, '|')) {
+            std::vector<std::string> symbols = split(alternative);
+            if (symbols.size() == 1 && symbols[0] == "''") symbols.clear();
+            if (symbols.empty() && alternative.find("''") == std::string::npos) continue; // "| x" leaves an empty first part
+            rules.push_back({ lhs, symbols });
+        }
+    }
+    if (rules.empty()) {
+        std::cerr << path << ": no rules\n";
+        return false;
+    }
+    return true;
+}
+
+std::string upper(const std::string& text) {
+    std::string result;
+    for (char c : text) result += static_cast<char>(std::toupper(static_cast<unsigned char>(c)));
+    return result;
+}
+
+// Terminal for a grammar symbol that is not a rule
+bool terminalFor(const std::string& spelling, TerminalSpec& spec) {
+    static const std::map<std::string, TokenType> lexemeRules = {
+        { "string", TokenType::STRING }, { "number", TokenType::INT }, { "time", TokenType::TIME }, { "ID", TokenType::ID }
+    };
+    spec.spelling = spelling;
+    if (spelling.size() > 2 && spelling.front() == '\'' && spelling.back() == '\'') {
+        if (!terminalFor(spelling.substr(1, spelling.size() - 2), spec)) return false;
+        spec.spelling = spelling;
+        return true;
+    }
+    auto rule = lexemeRules.find(spelling);
+    if (rule != lexemeRules.end()) {
+        spec.type = rule->second;
+        spec.name = TokenTypeLiteral[static_cast<int>(spec.type)];
+        return true;
+    }
+    for (const Keyword& fixed : SYMBOLS) {
+        if (fixed.text == spelling) {
+            spec.type = fixed.type;
+            spec.name = TokenTypeLiteral[static_cast<int>(spec.type)];
+            return true;
+        }
+    }
+    for (const Keyword& fixed : KEYWORDS) {
+        if (fixed.text == spelling) {
+            spec.type = fixed.type;
+            spec.name = TokenTypeLiteral[static_cast<int>(spec.type)];
+            return true;
+        }
+    }
+    return false;
+}
+
+// expression' -> EXPRESSION_TAIL
+std::string enumName(const std::string& rule) {
+    std::string name = upper(rule);
+    for (size_t quote = name.find('\''); quote != std::string::npos; quote = name.find('\'')) name.replace(quote, 1, "_TAIL");
+    return name;
+}
+
+class Grammar {
+public:
+    std::vector<TerminalSpec> terminals;  // Terminal k is symbol k; terminals[0] is "$"
+    std::vector<std::string> nonterminals; // Symbol terminals.size() + k
+    std::vector<Rule> rules;
+    std::vector<std::vector<int>> productions; // Symbol IDs of each rule's right side
+    std::vector<int> heads;
+    std::vector<std::set<int>> first;   // Per nonterminal, terminals only
+    std::vector<std::set<int>> follow;
+    std::vector<bool> nullable;
+    std::vector<std::vector<int>> table; // [nonterminal][terminal] = production, -1 for none
+    std::vector<std::string> conflicts;
+
+    bool isTerminal(int symbol) const {
+        return symbol < static_cast<int>(terminals.size());
+    }
+    std::string spelling(int symbol) const {
+        return isTerminal(symbol) ? terminals[symbol].spelling : nonterminals[symbol - terminals.size()];
+    }
+
+    bool build(const std::vector<Rule>& all) {
+        // Keep the rules the start symbol reaches, lexeme rules excluded
+        std::set<std::string> names;
+        for (const Rule& rule : all) {
+            if (!LEXEME_RULES.count(rule.lhs)) names.insert(rule.lhs);
+        }
+        std::set<std::string> reached = { all[0].lhs };
+        std::vector<std::string> pending = { all[0].lhs };
+        while (!pending.empty()) {
+            std::string name = pending.back();
+            pending.pop_back();
+            for (const Rule& rule : all) {
+                if (rule.lhs != name) continue;
+                for (const std::string& symbol : rule.rhs) {
+                    if (names.count(symbol) && reached.insert(symbol).second) pending.push_back(symbol);
+                }
+            }
+        }
+        for (const Rule& rule : all) {
+            if (reached.count(rule.lhs)) {
+                rules.push_back(rule);
+                if (std::find(nonterminals.begin(), nonterminals.end(), rule.lhs) == nonterminals.end()) nonterminals.push_back(rule.lhs);
+            }
+        }
+
+        // Terminals in order of first use, "$" first
+        TerminalSpec end;
+        terminalFor("$", end);
+        terminals.push_back(end);
+        for (const Rule& rule : rules) {
+            for (const std::string& symbol : rule.rhs) {
+                if (reached.count(symbol)) continue;
+                bool known = false;
+                for (const TerminalSpec& terminal : terminals) known = known || terminal.spelling == symbol;
+                if (known) continue;
+                TerminalSpec spec;
+                if (!terminalFor(symbol, spec)) {
+                    std::cerr << "Unknown terminal " << symbol << " in the rule of " << rule.lhs << "\n";
+                    return false;
+                }
+                terminals.push_back(spec);
+            }
+        }
+        // Generated names must not clash, and terminalOf() needs a token type per terminal
+        std::set<std::string> enumerators;
+        for (const TerminalSpec& terminal : terminals) {
+            if (!enumerators.insert(terminal.name).second) {
+                std::cerr << "Terminals spelled differently are the same token (" << terminal.name << ")\n";
+                return false;
+            }
+        }
+        for (const std::string& name : nonterminals) {
+            if (!enumerators.insert(enumName(name)).second) {
+                std::cerr << "Rule " << name << " has the same name as a terminal (" << enumName(name) << ")\n";
+                return false;
+            }
+        }
+
+        auto id = [this](const std::string& symbol) {
+            for (size_t k = 0; k < nonterminals.size(); k++) {
+                if (nonterminals[k] == symbol) return static_cast<int>(terminals.size() + k);
+            }
+            for (size_t k = 0; k < terminals.size(); k++) {
+                if (terminals[k].spelling == symbol) return static_cast<int>(k);
+            }
+            return -1;
+        };
+        for (const Rule& rule : rules) {
+            heads.push_back(id(rule.lhs));
+            std::vector<int> symbols;
+            for (const std::string& symbol : rule.rhs) symbols.push_back(id(symbol));
+            productions.push_back(symbols);
+        }
+        // TABLE entries are uint8_t and 0xFF is NO_PRODUCTION
+        if (productions.size() >= 0xFF) {
+            std::cerr << productions.size() << " productions, a TABLE entry names at most 254\n";
+            return false;
+        }
+        if (!productive()) return false;
+        computeSets();
+        buildTable();
+        return conflicts.empty();
+    }
+
+private:
+    size_t index(int nonterminal) const {
+        return nonterminal - terminals.size();
+    }
+    // Every rule must derive some string of terminals, else its parse never ends
+    bool productive() const {
+        std::vector<bool> done(nonterminals.size(), false);
+        for (bool changed = true; changed;) {
+            changed = false;
+            for (size_t p = 0; p < productions.size(); p++) {
+                if (done[index(heads[p])]) continue;
+                bool all = true;
+                for (int symbol : productions[p]) all = all && (isTerminal(symbol) || done[index(symbol)]);
+                if (all) done[index(heads[p])] = changed = true;
+            }
+        }
+        for (size_t k = 0; k < nonterminals.size(); k++) {
+            if (!done[k]) std::cerr << "Rule " << nonterminals[k] << " derives no input (left recursive?)\n";
+        }
+        return std::find(done.begin(), done.end(), false) == done.end();
+    }
+    // FIRST of symbols[from...] into out; true when all of them can be empty
+    bool firstOf(const std::vector<int>& symbols, size_t from, std::set<int>& out) const {
+        for (size_t k = from; k < symbols.size(); k++) {
+            if (isTerminal(symbols[k])) {
+                out.insert(symbols[k]);
+                return false;
+            }
+            const std::set<int>& sub = first[index(symbols[k])];
+            out.insert(sub.begin(), sub.end());
+            if (!nullable[index(symbols[k])]) return false;
+        }
+        return true;
+    }
+    void computeSets() {
+        first.assign(nonterminals.size(), {});
+        follow.assign(nonterminals.size(), {});
+        nullable.assign(nonterminals.size(), false);
+        follow[0].insert(0); // $ after the start symbol
+        for (bool changed = true; changed;) {
+            changed = false;
+            for (size_t p = 0; p < productions.size(); p++) {
+                size_t head = index(heads[p]);
+                std::set<int> out;
+                bool empty = firstOf(productions[p], 0, out);
+                size_t before = first[head].size();
+                first[head].insert(out.begin(), out.end());
+                changed = changed || first[head].size() != before;
+                if (empty && !nullable[head]) nullable[head] = changed = true;
+            }
+        }
+        for (bool changed = true; changed;) {
+            changed = false;
+            for (size_t p = 0; p < productions.size(); p++) {
+                const std::vector<int>& symbols = productions[p];
+                for (size_t k = 0; k < symbols.size(); k++) {
+                    if (isTerminal(symbols[k])) continue;
+                    std::set<int> out;
+                    bool rest = firstOf(symbols, k + 1, out);
+                    if (rest) out.insert(follow[index(heads[p])].begin(), follow[index(heads[p])].end());
+                    std::set<int>& target = follow[index(symbols[k])];
+                    size_t before = target.size();
+                    target.insert(out.begin(), out.end());
+                    changed = changed || target.size() != before;
+                }
+            }
+        }
+    }
+    void buildTable() {
+        table.assign(nonterminals.size(), std::vector<int>(terminals.size(), -1));
+        for (size_t p = 0; p < productions.size(); p++) {
+            size_t head = index(heads[p]);
+            std::set<int> lookahead;
+            if (firstOf(productions[p], 0, lookahead)) lookahead.insert(follow[head].begin(), follow[head].end());
+            for (int terminal : lookahead) {
+                int& entry = table[head][terminal];
+                if (entry >= 0 && entry != static_cast<int>(p)) {
+                    conflicts.push_back(nonterminals[head] + " on " + terminals[terminal].spelling + ": \"" +
+                        describe(entry) + "\" and \"" + describe(static_cast<int>(p)) + "\"");
+                }
+                else entry = static_cast<int>(p);
+            }
+        }
+    }
+
+public:
+    std::string describe(int production) const {
+        std::string text = rules[production].lhs + " ->";
+        for (const std::string& symbol : rules[production].rhs) text += " " + symbol;
+        if (rules[production].rhs.empty()) text += " ''";
+        return text;
+    }
+    std::string setText(const std::set<int>& symbols, bool empty) const {
+        std::string text = "{";
+        for (int symbol : symbols) text += " " + spelling(symbol);
+        if (empty) text += " ''";
+        return text + " }";
+    }
+};
+
+//HEADER OUTPUT
+
+void writeHeader(const Grammar& grammar, const std::string& source, std::ostream& out) {
+    size_t longest = 0;
+    for (const std::vector<int>& symbols : grammar.productions) longest = std::max(longest, symbols.size());
+
+    out << "#pragma once\n\n#include \"Scanner.h\"\n\n";
+    out << "//PARSE TABLE\n/*\nGenerated by ParseTableGenerator from " << source << ", do not edit: change the grammar\n";
+    out << "and run the generator again (see ParseTableGenerator.cpp).\n\n";
+    for (size_t p = 0; p < grammar.productions.size(); p++) {
+        out << (p < 10 ? " " : "") << p << "  " << grammar.describe(static_cast<int>(p)) << "\n";
+    }
+    out << "\n";
+    for (size_t k = 0; k < grammar.nonterminals.size(); k++) {
+        out << grammar.nonterminals[k] << "\n    FIRST  " << grammar.setText(grammar.first[k], grammar.nullable[k]) << "\n";
+        out << "    FOLLOW " << grammar.setText(grammar.follow[k], false) << "\n";
+    }
+    out << "*/\n";
+    out << "namespace grammar {\n\n";
+
+    out << "// Terminals (0.." << grammar.terminals.size() - 1 << "), then rules\n";
+    out << "enum Symbol : uint16_t {\n";
+    for (const TerminalSpec& terminal : grammar.terminals) out << "    " << terminal.name << ", // " << terminal.spelling << "\n";
+    for (const std::string& name : grammar.nonterminals) out << "    " << enumName(name) << ",\n";
+    out << "    SYMBOL_COUNT\n};\n";
+    out << "const uint16_t TERMINAL_COUNT = " << grammar.terminals.size() << ";\n";
+    out << "const uint16_t START = " << enumName(grammar.nonterminals[0]) << ";\n";
+    out << "const uint16_t NO_TERMINAL = SYMBOL_COUNT; // A token the grammar doesn't use\n";
+    out << "const uint8_t NO_PRODUCTION = 0xFF;\n\n";
+
+    out << "// Token type of each terminal\n";
+    out << "constexpr TokenType TERMINAL_TYPES[TERMINAL_COUNT] = {";
+    for (size_t k = 0; k < grammar.terminals.size(); k++) {
+        out << (k % 6 == 0 ? "\n    " : " ") << "TokenType::" << TokenTypeLiteral[static_cast<int>(grammar.terminals[k].type)] << ",";
+    }
+    out << "\n};\n\n";
+
+    out << "// tail: the last symbol is the rule itself (a loop, see Parser::parseProgram)\n";
+    out << "struct Production {\n    uint16_t head;\n    uint8_t length;\n    bool tail;\n    uint16_t symbols[" << longest << "];\n};\n";
+    out << "constexpr Production PRODUCTIONS[] = {\n";
+    for (size_t p = 0; p < grammar.productions.size(); p++) {
+        const std::vector<int>& symbols = grammar.productions[p];
+        bool tail = !symbols.empty() && symbols.back() == grammar.heads[p];
+        out << "    { " << enumName(grammar.rules[p].lhs) << ", " << symbols.size() << ", " << (tail ? "true" : "false") << ", {";
+        for (size_t k = 0; k < symbols.size(); k++) {
+            out << (k ? ", " : " ");
+            if (grammar.isTerminal(symbols[k])) out << grammar.terminals[symbols[k]].name;
+            else out << enumName(grammar.spelling(symbols[k]));
+        }
+        out << (symbols.empty() ? "} },\n" : " } },\n");
+    }
+    out << "};\n\n";
+
+    out << "// Production to expand a rule with on each terminal\n";
+    out << "const uint8_t TABLE[SYMBOL_COUNT - TERMINAL_COUNT][TERMINAL_COUNT] = {\n";
+    for (size_t k = 0; k < grammar.nonterminals.size(); k++) {
+        out << "    {";
+        for (size_t t = 0; t < grammar.terminals.size(); t++) {
+            int entry = grammar.table[k][t];
+            out << (t ? ", " : " ");
+            if (entry < 0) out << "NO_PRODUCTION";
+            else out << entry;
+        }
+        out << " }, // " << grammar.nonterminals[k] << "\n";
+    }
+    out << "};\n\n";
+
+    out << "// Terminal of each token type (every reserved word has its own), NO_TERMINAL for the rest\n";
+    out << "constexpr std::array<uint16_t, static_cast<size_t>(TokenType::END)> buildTerminalOf() {\n";
+    out << "    std::array<uint16_t, static_cast<size_t>(TokenType::END)> table{};\n";
+    out << "    for (uint16_t& terminal : table) terminal = NO_TERMINAL;\n";
+    out << "    for (uint16_t k = 0; k < TERMINAL_COUNT; k++) table[static_cast<size_t>(TERMINAL_TYPES[k])] = k;\n";
+    out << "    return table;\n}\n";
+    out << "constexpr auto TERMINAL_OF = buildTerminalOf();\n\n";
+    out << "uint16_t terminalOf(const Token& token) {\n    return TERMINAL_OF[static_cast<size_t>(token.type)];\n}\n\n}\n";
+}
+
+// The header as it is on disk, without the '\r' a checkout may add
+bool readHeader(const std::string& path, std::string& text) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) return false;
+    std::stringstream content;
+    content << file.rdbuf();
+    text.clear();
+    for (char c : content.str()) {
+        if (c != '\r') text += c;
+    }
+    return true;
+}
+
+int main(int argc, char** argv) {
+    bool check = argc == 4 && std::string(argv[1]) == "--check";
+    if (argc != 3 && !check) {
+        std::cerr << "Usage: ParseTableGenerator [--check] <grammar> <header>\n";
+        return 1;
+    }
+    if (check) argv++;
+    std::vector<Rule> rules;
+    if (!readGrammar(argv[1], rules)) return 1;
+    Grammar grammar;
+    if (!grammar.build(rules)) {
+        if (grammar.conflicts.empty()) return 1;
+        std::cerr << "The grammar is not LL(1):\n";
+        for (const std::string& conflict : grammar.conflicts) std::cerr << "  " << conflict << "\n";
+        return 1;
+    }
+
+    std::string source = argv[1];
+    source = source.substr(source.find_last_of("/\\") + 1);
+    if (check) {
+        std::ostringstream expected;
+        writeHeader(grammar, source, expected);
+        std::string current;
+        if (!readHeader(argv[2], current)) {
+            std::cerr << "Can't read " << argv[2] << "\n";
+            return 1;
+        }
+        if (current != expected.str()) {
+            std::cerr << argv[2] << " doesn't match " << argv[1] << ": run ParseTableGenerator " << argv[1] << " " << argv[2] << "\n";
+            return 1;
+        }
+        std::cout << argv[2] << " matches " << argv[1] << "\n";
+        return 0;
+    }
+    std::ofstream out(argv[2], std::ios::binary);
+    writeHeader(grammar, source, out);
+    if (!out) {
+        std::cerr << "Can't write " << argv[2] << "\n";
+        return 1;
+    }
+    std::cout << grammar.productions.size() << " productions, " << grammar.nonterminals.size() << " rules, "
+        << grammar.terminals.size() << " terminals: " << argv[2] << "\n";
+    return 0;
+}
@@ -1,578 +1,974 @@
-#pragma once
-
-//ASTNode Docs 
-//(Abstract syntax tree (AST) - DataStructure used to represent the syntactic structure of the code in a programming language.)
-/*
-//////////////////////////////////////////////////////////////
-COMMANDS ->
-"play"   -
-"frame"  -
-"concat" -
-"audio"  -
-"#"      -
-//////////////////////////////////////////////////////////////
-source1     - Main Input file for "play" and "frame"
-source2     - Second input file for operations like "concat".
-argStart    - Frame start time
-argEnd      - Frame end time
-destination - output filename
-//////////////////////////////////////////////////////////////
-*/
-
-
-#include "Scanner.h"
-
-
-
-
-// Represents a value in the language (number, string, or time).
-struct Value {
-    enum { NUMBER, STRING, TIME } type;
-    int num;
-    std::string str;
-    TimePosition time;
-    Value(int n = 0) : type(NUMBER), num(n), str(""), time(0, 0) {}
-    Value(const std::string& s) : type(STRING), num(0), str(s), time(0, 0) {}
-    Value(const TimePosition& t) : type(TIME), num(0), str(""), time(t) {}
-};
-
-struct ASTNode {
-    std::string command; // let, frame, concat, audio, play, if
-    std::string varName; // For let
-    std::vector<Token> expr1;
-    std::vector<Token> expr2;
-    std::vector<Token> expr3;
-    std::string destination; // Output file
-    std::vector<ASTNode*> statements; // For program
-    //ASTNode* thenStmt; // For if statements
-
-
-
-    ASTNode(const std::string& cmd = "", const std::string& var = "",
-        const std::vector<Token>& e1 = {}, const std::vector<Token>& e2 = {},
-        const std::vector<Token>& e3 = {}, const std::string& dest = "")
-        : command(cmd), varName(var), expr1(e1), expr2(e2), expr3(e3), destination(dest) {
-    }
-
-
-
-    // Copy constructor
-    ASTNode(const ASTNode& other)
-        : command(other.command), varName(other.varName),
-        expr1(other.expr1), expr2(other.expr2), expr3(other.expr3),
-        destination(other.destination) {
-        for (const auto* stmt : other.statements) {
-            statements.push_back(new ASTNode(*stmt)); // Deep copy
-        }
-    }
-
-    ~ASTNode() {
-        for (auto* stmt : statements) {
-            delete stmt;
-        }
-    }
-    // Copy assignment
-    ASTNode& operator=(const ASTNode& other) {
-        if (this != &other) {
-            for (auto* stmt : statements) {
-                delete stmt;
-            }
-            statements.clear();
-            command = other.command;
-            varName = other.varName;
-            expr1 = other.expr1;
-            expr2 = other.expr2;
-            expr3 = other.expr3;
-            destination = other.destination;
-            for (const auto* stmt : other.statements) {
-                statements.push_back(new ASTNode(*stmt));
-            }
-        }
-        return *this;
-    }
-
-    // Move constructor
-    ASTNode(ASTNode&& other) noexcept
-        : command(std::move(other.command)), varName(std::move(other.varName)),
-        expr1(std::move(other.expr1)), expr2(std::move(other.expr2)),
-        expr3(std::move(other.expr3)), destination(std::move(other.destination)),
-        statements(std::move(other.statements)) {
-        other.statements.clear();
-    }
-    // Move assignment
-    ASTNode& operator=(ASTNode&& other) noexcept {
-        if (this != &other) {
-            for (auto* stmt : statements) {
-                delete stmt;
-            }
-            statements.clear();
-            command = std::move(other.command);
-            varName = std::move(other.varName);
-            expr1 = std::move(other.expr1);
-            expr2 = std::move(other.expr2);
-            expr3 = std::move(other.expr3);
-            destination = std::move(other.destination);
-            statements = std::move(other.statements);
-            other.statements.clear();
-        }
-        return *this;
-    }
-    // Constructor for ASTNode to initialize all fields
-
-};
-
-class Parser {
-    std::vector<Token> tokens;
-    size_t pos;
-    std::unordered_map<std::string, Value> variables;
-    std::vector<ScannerError> errors;
-
-    //PANIC MODE FUNCTIONS
-
-    // Check if token matches type without advancing
-    bool check(TokenType type) const {
-        return pos < tokens.size() && tokens[pos].type == type;
-    }
-    // Advance to next token
-    void advance() { if (pos < tokens.size()) pos++; }
-    // Synchronize to next statement or EOP
-    void synchronize() {
-        while (pos < tokens.size() && tokens[pos].type != TokenType::EOP) {
-            if (tokens[pos].type == TokenType::SEMICOLON) {
-                advance(); // Move past semicolon
-                return;
-            }
-            if (tokens[pos].type == TokenType::LET || tokens[pos].type == TokenType::IF ||
-                tokens[pos].type == TokenType::KEYWORD) {
-                return; // Ready for next statement
-            }
-            advance();
-        }
-    }
-
-    //PARSER FUNCTIONS
-    bool expect(TokenType type) {
-        if (check(type)) {
-            advance();
-            return true;
-        }
-        errors.push_back({ tokens[pos].line, tokens[pos].charPos, "UnexpectedToken",
-                          "Expected " + TokenTypeLiteral[(int)type] + ", got " +
-                          (pos < tokens.size() ? tokens[pos].value : "EOF") });
-        synchronize();
-        return false;
-    }
-
-    std::vector<Token> parseExpression() {
-        std::vector<Token> expr;
-        if (check(TokenType::OPEN_PAR)) {
-            advance();
-            expr = parseExpression();
-            if (!expect(TokenType::CLOSE_PAR)) return {};
-        }
-        else {
-            if (!(check(TokenType::INT) || check(TokenType::STRING) ||
-                check(TokenType::TIME) || check(TokenType::ID))) {
-                errors.push_back({ tokens[pos].line, tokens[pos].charPos, "InvalidExpression",
-                                  "Expected number, string, time, or identifier" });
-                synchronize();
-                return {};
-            }
-            expr.push_back(tokens[pos++]);
-        }
-        while (pos < tokens.size() && (check(TokenType::ADD_OP) || check(TokenType::MUL_OP))) {
-            expr.push_back(tokens[pos++]);
-            if (check(TokenType::OPEN_PAR)) {
-                advance();
-                auto subExpr = parseExpression();
-                if (!expect(TokenType::CLOSE_PAR)) return {};
-                expr.insert(expr.end(), subExpr.begin(), subExpr.end());
-            }
-            else {
-                if (!(check(TokenType::INT) || check(TokenType::STRING) ||
-                    check(TokenType::TIME) || check(TokenType::ID))) {
-                    errors.push_back({ tokens[pos].line, tokens[pos].charPos, "InvalidExpression",
-                                      "Expected number, string, time, or identifier" });
-                    synchronize();
-                    return {};
-                }
-                expr.push_back(tokens[pos++]);
-            }
-        }
-        return expr;
-    }
-
-    Value evaluate(const std::vector<Token>& expr) {
-        if (expr.size() == 1) {
-            if (expr[0].type == TokenType::INT) return Value(std::stoi(expr[0].value));
-            if (expr[0].type == TokenType::STRING) return Value(expr[0].value);
-            if (expr[0].type == TokenType::TIME) return Value(TimePosition(expr[0].value));
-            if (expr[0].type == TokenType::ID && variables.count(expr[0].value)) return variables[expr[0].value];
-            errors.push_back({ expr[0].line, expr[0].charPos, "UnknownIdentifier", "Unknown identifier: " + expr[0].value });
-            throw std::runtime_error("Unknown identifier: " + expr[0].value);
-        }
-
-        Value result = evaluate({ expr[0] });
-        for (size_t i = 1; i < expr.size(); i += 2) {
-            Token op = expr[i];
-            Value rhs = evaluate({ expr[i + 1] });
-            if (op.type == TokenType::ADD_OP) {
-                if (result.type == Value::STRING && rhs.type == Value::STRING) {
-                    result.str += rhs.str;
-                }
-                else if (result.type == Value::TIME && rhs.type == Value::TIME) {
-                    result.time = result.time + rhs.time;
-                }
-                else {
-                    errors.push_back({ op.line, op.charPos, "TypeError", "Invalid + operands" });
-                    throw std::runtime_error("Invalid + operands");
-                }
-            }
-            else if (op.type == TokenType::MUL_OP) {
-                if (result.type == Value::TIME && rhs.type == Value::NUMBER) {
-                    result.time = result.time * rhs.num;
-                }
-                else if (result.type == Value::NUMBER && rhs.type == Value::TIME) {
-                    result.time = rhs.time * result.num;
-                }
-                else {
-                    errors.push_back({ op.line, op.charPos, "TypeError", "Multiplication only defined for time * number" });
-                    throw std::runtime_error("Multiplication only defined for time * number");
-                }
-            }
-        }
-        return result;
-    }
-
-    ASTNode parseProgram() {
-        ASTNode root{ "program" };
-        while (pos < tokens.size() && tokens[pos].type != TokenType::EOP) {
-            try {
-                ASTNode* stmt = new ASTNode(parseStatement());
-                root.statements.push_back(stmt);
-            }
-            catch (...) {
-                synchronize();
-            }
-        }
-        if (check(TokenType::EOP)) advance();
-        return root;
-    }
-
-    ASTNode parseStatement() {
-        if (check(TokenType::LET)) {
-            return parseAssign();
-        }
-        else if (check(TokenType::IF)) {
-            return parseIfStmt();
-        }
-        else if (check(TokenType::KEYWORD)) {
-            return parseCommand();
-        }
-        errors.push_back({ tokens[pos].line, tokens[pos].charPos, "InvalidStatement",
-                          "Expected let, if, or command" });
-        synchronize();
-        return { "error" }; // Placeholder node
-    }
-    ASTNode parseAssign() {
-        if (!expect(TokenType::LET)) return { "error" };
-        std::string varName = tokens[pos].value;
-        if (!expect(TokenType::ID)) return { "error" };
-        if (!expect(TokenType::ASSIGN_OP)) return { "error" };
-        auto expr = parseExpression();
-        if (!expect(TokenType::SEMICOLON)) return { "error" };
-        if (!expr.empty()) variables[varName] = evaluate(expr);
-        return { "let", varName, expr, {}, {}, "" };
-    }
-
-    ASTNode parseCommand() {
-        std::string cmd = tokens[pos].value;
-        if (!expect(TokenType::KEYWORD)) return { "error" };
-        if (cmd == "frame") {
-            auto expr1 = parseExpression();
-            if (expr1.empty()) return { "error" };
-            auto expr2 = parseExpression();
-            if (expr2.empty()) return { "error" };
-            if (!expect(TokenType::TO)) return { "error" };
-            std::string dest = tokens[pos].value;
-            if (!expect(TokenType::STRING)) return { "error" };
-            if (!expect(TokenType::SEMICOLON)) return { "error" };
-            return { cmd, "", expr1, expr2, {}, dest };
-        }
-        else if (cmd == "concat") {
-            auto expr1 = parseExpression();
-            if (expr1.empty()) return { "error" };
-            auto expr2 = parseExpression();
-            if (expr2.empty()) return { "error" };
-            if (!expect(TokenType::TO)) return { "error" };
-            std::string dest = tokens[pos].value;
-            if (!expect(TokenType::STRING)) return { "error" };
-            if (!expect(TokenType::SEMICOLON)) return { "error" };
-            return { cmd, "", expr1, expr2, {}, dest };
-        }
-        else if (cmd == "audio") {
-            auto expr1 = parseExpression();
-            if (expr1.empty()) return { "error" };
-            auto expr2 = parseExpression();
-            if (expr2.empty()) return { "error" };
-            auto expr3 = parseExpression();
-            if (expr3.empty()) return { "error" };
-            if (!expect(TokenType::TO)) return { "error" };
-            std::string dest = tokens[pos].value;
-            if (!expect(TokenType::STRING)) return { "error" };
-            if (!expect(TokenType::SEMICOLON)) return { "error" };
-            return { cmd, "", expr1, expr2, expr3, dest };
-        }
-        else if (cmd == "play") {
-            auto expr1 = parseExpression();
-            if (expr1.empty()) return { "error" };
-            if (check(TokenType::SEMICOLON)) {
-                expect(TokenType::SEMICOLON);
-                return { cmd, "", expr1, {}, {}, "" };
-            }
-            auto expr2 = parseExpression();
-            if (expr2.empty()) return { "error" };
-            auto expr3 = parseExpression();
-            if (expr3.empty()) return { "error" };
-            if (!expect(TokenType::SEMICOLON)) return { "error" };
-            return { cmd, "", expr1, expr2, expr3, "" };
-        }
-        errors.push_back({ tokens[pos - 1].line, tokens[pos - 1].charPos, "UnknownCommand", "Unknown command: " + cmd });
-        synchronize();
-        return { "error" };
-    }
-
-    ASTNode parseIfStmt() {
-        if (!expect(TokenType::IF)) return { "error" };
-        auto expr1 = parseExpression();
-        if (expr1.empty()) return { "error" };
-        if (!expect(TokenType::EQUALS)) return { "error" };
-        auto expr2 = parseExpression();
-        if (expr2.empty()) return { "error" };
-        if (!expect(TokenType::THEN)) return { "error" };
-        ASTNode* stmt = new ASTNode(parseStatement());
-        ASTNode node{ "if", "", expr1, expr2, {}, "" };
-        node.statements.push_back(stmt);
-        return node;
-    }
-
-
-    std::string exprToString(const std::vector<Token>& expr) const {
-        std::string result;
-        for (const auto& token : expr) {
-            result += token.value + " ";
-        }
-        return result.empty() ? "" : result.substr(0, result.size() - 1);
-    }
-    void printAST(const ASTNode& node, std::ofstream& out, const std::string& parent = "") const {
-        // Generate unique node ID to avoid name clashes
-        static int nodeCounter = 0;
-        std::string nodeId = "node_" + std::to_string(nodeCounter++);
-        
-        // Create the main command node
-        std::string commandName = node.command;
-        if (node.command == "error") {
-            commandName = "ERROR";
-        }
-        
-        // Write main command node
-        if (parent.empty()) {
-            out << nodeId << " = Node(\"" << commandName << "\")\n";
-        }
-        else {
-            out << nodeId << " = Node(\"" << commandName << "\", parent=" << parent << ")\n";
-        }
-        
-
-        if (node.command == "let") {
- 
-            std::string varNodeId = "node_" + std::to_string(nodeCounter++);
-            std::string exprNodeId = "node_" + std::to_string(nodeCounter++);
-            
-            out << varNodeId << " = Node(\"var: " << node.varName << "\", parent=" << nodeId << ")\n";
-            out << exprNodeId << " = Node(\"expr: " << exprToString(node.expr1) << "\", parent=" << nodeId << ")\n";
-        }
-        else if (node.command == "if") {
-
-            std::string expr1NodeId = "node_" + std::to_string(nodeCounter++);
-            std::string expr2NodeId = "node_" + std::to_string(nodeCounter++);
-            
-            out << expr1NodeId << " = Node(\"left: " << exprToString(node.expr1) << "\", parent=" << nodeId << ")\n";
-            out << expr2NodeId << " = Node(\"right: " << exprToString(node.expr2) << "\", parent=" << nodeId << ")\n";
-        }
-        else if (node.command == "frame" || node.command == "concat") {
-
-            std::string expr1NodeId = "node_" + std::to_string(nodeCounter++);
-            std::string expr2NodeId = "node_" + std::to_string(nodeCounter++);
-            std::string destNodeId = "node_" + std::to_string(nodeCounter++);
-            
-            out << expr1NodeId << " = Node(\"arg1: " << exprToString(node.expr1) << "\", parent=" << nodeId << ")\n";
-            out << expr2NodeId << " = Node(\"arg2: " << exprToString(node.expr2) << "\", parent=" << nodeId << ")\n";
-            out << destNodeId << " = Node(\"dest: " << node.destination << "\", parent=" << nodeId << ")\n";
-        }
-        else if (node.command == "audio") {
-
-            std::string expr1NodeId = "node_" + std::to_string(nodeCounter++);
-            std::string expr2NodeId = "node_" + std::to_string(nodeCounter++);
-            std::string expr3NodeId = "node_" + std::to_string(nodeCounter++);
-            std::string destNodeId = "node_" + std::to_string(nodeCounter++);
-            
-            out << expr1NodeId << " = Node(\"arg1: " << exprToString(node.expr1) << "\", parent=" << nodeId << ")\n";
-            out << expr2NodeId << " = Node(\"arg2: " << exprToString(node.expr2) << "\", parent=" << nodeId << ")\n";
-            out << expr3NodeId << " = Node(\"arg3: " << exprToString(node.expr3) << "\", parent=" << nodeId << ")\n";
-            out << destNodeId << " = Node(\"dest: " << node.destination << "\", parent=" << nodeId << ")\n";
-        }
-        else if (node.command == "play") {
-
-            std::string expr1NodeId = "node_" + std::to_string(nodeCounter++);
-            out << expr1NodeId << " = Node(\"arg1: " << exprToString(node.expr1) << "\", parent=" << nodeId << ")\n";
-            
-
-            if (!node.expr2.empty()) {
-                std::string expr2NodeId = "node_" + std::to_string(nodeCounter++);
-                std::string expr3NodeId = "node_" + std::to_string(nodeCounter++);
-                
-                out << expr2NodeId << " = Node(\"arg2: " << exprToString(node.expr2) << "\", parent=" << nodeId << ")\n";
-                out << expr3NodeId << " = Node(\"arg3: " << exprToString(node.expr3) << "\", parent=" << nodeId << ")\n";
-            }
-        }
-        
-        // Recursively print child statements
-        for (size_t i = 0; i < node.statements.size(); ++i) {
-            printAST(*node.statements[i], out, nodeId);
-        }
-    }
-
-public:
-    Parser(const std::vector<Token>& t) : tokens(t), pos(0) {}
-    /*
-    void parseAndExecute() {
-        if (!errors.empty()) {
-            for (const auto& err : errors) {
-                std::cerr << "Error at line " << err.line << ", col " << err.charPos << ": " << err.type << " - " << err.message << "\n";
-            }
-            errors.clear();
-        }
-        ASTNode program = parseProgram();
-        if (!errors.empty()) {
-            for (const auto& err : errors) {
-                std::cerr << "Error at line " << err.line << ", col " << err.charPos << ": " << err.type << " - " << err.message << "\n";
-            }
-        }
-        else {
-            // Generate AST.txt if parsing succeeded
-            std::ofstream out("AST.py");
-            if (out.is_open()) {
-                out << "from anytree import Node\n\n";
-                printAST(program, out);
-                out.close();
-            }
-            //execute(program);
-        }
-    }
-    */
-    void parseAndExecute() {
-        if (!errors.empty()) {
-            for (const auto& err : errors) {
-                std::cerr << "Error at line " << err.line << ", col " << err.charPos << ": "
-                    << err.type << " - " << err.message << "\n";
-            }
-            errors.clear();
-        }
-
-        ASTNode program = parseProgram();
-
-        if (!errors.empty()) {
-            for (const auto& err : errors) {
-                std::cerr << "Error at line " << err.line << ", col " << err.charPos << ": "
-                    << err.type << " - " << err.message << "\n";
-            }
-        }
-        else {
-            // Write AST visualization (tree form)
-            std::ofstream treeOut("AST.py");
-            if (treeOut.is_open()) {
-                treeOut << "from anytree import Node\n\n";
-                printAST(program, treeOut);
-                treeOut.close();
-            }
-
-            // Write executable Python code
-            std::ofstream pyOut("generated_video_script.py");
-            if (pyOut.is_open()) {
-                translateToPython(program, pyOut);
-                pyOut.close();
-                std::cout << "Generated Python script: generated_video_script.py\n";
-            }
-        }
-    }
-
-    // Video Operations Python
-
-    void translateToPython(const ASTNode& node, std::ofstream& out) {
-        if (node.command == "program") {
-            out << "import ffmpeg\n";
-            out << "import subprocess\n\n";
-            for (const auto* stmt : node.statements) {
-                translateToPython(*stmt, out);
-                out << "\n";
-            }
-            return;
-        }
-
-        if (node.command == "play") {
-            std::string file = exprToString(node.expr1);
-            out << "subprocess.run([\"vlc\", \"" << file << "\"";
-            if (!node.expr2.empty()) {
-                std::string start = exprToString(node.expr2);
-                std::string end = exprToString(node.expr3);
-                out << ", \"--start-time\", \"" << start << "\", \"--stop-time\", \"" << end << "\"";
-            }
-            out << "])\n";
-        }
-        else if (node.command == "frame") {
-            std::string input = exprToString(node.expr1);
-            std::string frameNum = exprToString(node.expr2);
-            out << "ffmpeg.input(\"" << input << "\")"
-                << ".filter(\"select\", \"eq(n\\\\," << frameNum << ")\")"
-                << ".output(\"" << node.destination << "\", vframes=1).run()\n";
-        }
-        else if (node.command == "concat") {
-            std::string input1 = exprToString(node.expr1);
-            std::string input2 = exprToString(node.expr2);
-            std::string dest = node.destination;
-
-            out << "# Convert inputs\n";
-            out << "ffmpeg.input(\"" << input1 << "\").output(\"converted_0.mp4\", vcodec='libx264', acodec='aac').run()\n";
-            out << "ffmpeg.input(\"" << input2 << "\").output(\"converted_1.mp4\", vcodec='libx264', acodec='aac').run()\n\n";
-
-            out << "# Write concat file list\n";
-            out << "with open('files.txt', 'w') as f:\n";
-            out << "    f.write(\"file 'converted_0.mp4'\\n\")\n";
-            out << "    f.write(\"file 'converted_1.mp4'\\n\")\n\n";
-
-            out << "# Concatenate with concat demuxer\n";
-            out << "subprocess.run(['ffmpeg', '-f', 'concat', '-safe', '0', '-i', 'files.txt', '-c', 'copy', '" << dest << "'])\n";
-        }
-
-
-        else if (node.command == "audio") {
-            std::string input = exprToString(node.expr1);
-            std::string start = exprToString(node.expr2);
-            std::string end = exprToString(node.expr3);
-            std::string dest = node.destination;
-
-            out << "ffmpeg.input(\"" << input << "\", ss=\"" << start << "\", to=\"" << end << "\")"
-                << ".output(\"" << dest << "\", vn=None, acodec='mp3').run()\n";
-        }
-        else if (node.command == "if") {
-            std::string cond1 = exprToString(node.expr1);
-            std::string cond2 = exprToString(node.expr2);
-            out << "if " << cond1 << " == " << cond2 << ":\n";
-            for (const auto* stmt : node.statements) {
-                out << "    ";
-                translateToPython(*stmt, out);
-            }
-        }
-    }
-};
+#pragma once
+
+//ASTNode Docs 
+//(Abstract syntax tree (AST) - DataStructure used to represent the syntactic structure of the code in a programming language.)
+/*
+//////////////////////////////////////////////////////////////
+COMMANDS ->
+"play"   -
+"frame"  -
+"concat" -
+"audio"  -
+"#"      -
+//////////////////////////////////////////////////////////////
+source1     - Main Input file for "play" and "frame"
+source2     - Second input file for operations like "concat".
+argStart    - Frame start time
+argEnd      - Frame end time
+destination - output filename
+//////////////////////////////////////////////////////////////
+*/
+
+
+#include "Arena.h"
+#include "ParseTable.h"
+#include "Scanner.h"
+#include "SpscRing.h"
+#include <initializer_list>
+#include <variant>
+
+
+
+
+// Represents a value in the language (number, string, or time).
+struct Value {
+    enum { NUMBER, STRING, TIME } type;
+    int num;
+    std::string str;
+    TimePosition time;
+    Value(int n = 0) : type(NUMBER), num(n), str(""), time(0, 0) {}
+    Value(const std::string& s) : type(STRING), num(0), str(s), time(0, 0) {}
+    Value(const TimePosition& t) : type(TIME), num(0), str(""), time(t) {}
+};
+
+struct ASTNode;
+
+// Kind of every ASTNode, in the order of the alternatives of ASTNode::payload. INVALID is a
+// statement that failed to parse (not ERROR, which <windows.h> defines as a macro).
+enum class NodeKind : uint8_t { PROGRAM, LET, FRAME, CONCAT, AUDIO, PLAY, IF, INVALID };
+const std::string_view NodeKindName[] = { "program", "let", "frame", "concat", "audio", "play", "if", "error" };
+
+// Expression tree: an operand (no children) or a binary operator over two subtrees.
+// Parentheses only shape the tree. Stored in the Parser's Arena, like the nodes that hold it;
+// the token itself stays in the token source and is read back by index (Parser::kind(), text()).
+struct ExprNode {
+    uint32_t token; // Index of the operand or operator token
+    // SymbolTable ID of an ID or STRING operand; for an INT or TIME operand of a TokenStream,
+    // its slot in literalValues
+    uint32_t value;
+    const ExprNode* left;
+    const ExprNode* right;
+
+    ExprNode(uint32_t t, uint32_t v, const ExprNode* l = nullptr, const ExprNode* r = nullptr)
+        : token(t), value(v), left(l), right(r) {
+    }
+};
+typedef const ExprNode* Expr;
+
+// Binding power of a binary operator (higher binds tighter), 0 for any other token
+int precedence(TokenType type) {
+    if (type == TokenType::MUL_OP) return 2;
+    if (type == TokenType::ADD_OP) return 1;
+    return 0;
+}
+
+// Payload of each kind (symbol IDs, see SymbolTable)
+struct ProgramNode { Slice<ASTNode*> statements; };
+struct LetNode { uint32_t variable; Expr value; };
+struct FrameNode { Expr input; Expr frame; uint32_t destination; };
+struct ConcatNode { Expr first; Expr second; uint32_t destination; };
+struct AudioNode { Expr input; Expr start; Expr end; uint32_t destination; };
+struct PlayNode { Expr input; Expr start; Expr end; }; // start/end null: the whole file
+struct IfNode { Expr left; Expr right; const ASTNode* then; };
+struct ErrorNode {}; // Placeholder for a statement that failed to parse
+
+// Lives in the Parser's Arena: built in place, never copied, freed with the arena
+struct ASTNode {
+    std::variant<ProgramNode, LetNode, FrameNode, ConcatNode, AudioNode, PlayNode, IfNode, ErrorNode> payload;
+
+    template <typename Payload>
+    explicit ASTNode(const Payload& p) : payload(p) {
+    }
+    NodeKind kind() const {
+        return static_cast<NodeKind>(payload.index());
+    }
+    // The payload of kind(), e.g. node.as<LetNode>() when kind() is NodeKind::LET; any other
+    // Payload throws std::bad_variant_access
+    template <typename Payload>
+    const Payload& as() const {
+        return std::get<Payload>(payload);
+    }
+};
+
+// What a matched token or a finished rule leaves on the parse stack's value stack
+struct ParseValue {
+    uint32_t token = 0; // A terminal: the index its ExprNode::token takes (Parser::reference())
+    uint32_t value = 0; // A terminal: its ExprNode::value, a symbol ID or literal slot
+    Expr expr = nullptr;
+    Expr second = nullptr; // condition: right side; play_args: end
+    ASTNode* node = nullptr;
+};
+
+// A rule that leaves no value of its own: each production is empty or loops (program, expression')
+constexpr bool loopRule(uint16_t rule) {
+    for (const grammar::Production& production : grammar::PRODUCTIONS) {
+        if (production.head == rule && production.length > 0 && !production.tail) return false;
+    }
+    return true;
+}
+// Symbols that leave a value: every other rule, and the terminals an action reads (names,
+// literals, operators). Keywords and punctuation leave none.
+constexpr std::array<bool, grammar::SYMBOL_COUNT> buildLeavesValue() {
+    std::array<bool, grammar::SYMBOL_COUNT> table{};
+    for (uint16_t symbol = 0; symbol < grammar::SYMBOL_COUNT; symbol++) {
+        if (symbol >= grammar::TERMINAL_COUNT) {
+            table[symbol] = !loopRule(symbol);
+            continue;
+        }
+        TokenType type = grammar::TERMINAL_TYPES[symbol];
+        table[symbol] = type == TokenType::ID || type == TokenType::STRING || type == TokenType::INT ||
+            type == TokenType::TIME || type == TokenType::ADD_OP || type == TokenType::MUL_OP;
+    }
+    return table;
+}
+constexpr auto LEAVES_VALUE = buildLeavesValue();
+// Values of each production's own symbols, the ones its action finds on top of values
+constexpr std::array<uint8_t, std::size(grammar::PRODUCTIONS)> buildValueCount() {
+    std::array<uint8_t, std::size(grammar::PRODUCTIONS)> table{};
+    for (size_t p = 0; p < table.size(); p++) {
+        const grammar::Production& production = grammar::PRODUCTIONS[p];
+        for (size_t k = 0; k < production.length; k++) table[p] += LEAVES_VALUE[production.symbols[k]];
+    }
+    return table;
+}
+constexpr auto VALUE_COUNT = buildValueCount();
+// Productions whose only value is the one of a rule (statement -> assign, expression ->
+// product expression', term -> ( expression )): they get no action at all
+constexpr std::array<bool, std::size(grammar::PRODUCTIONS)> buildPassThrough() {
+    std::array<bool, std::size(grammar::PRODUCTIONS)> table{};
+    for (size_t p = 0; p < table.size(); p++) {
+        const grammar::Production& production = grammar::PRODUCTIONS[p];
+        if (production.tail || VALUE_COUNT[p] != 1) continue;
+        for (size_t k = 0; k < production.length; k++) {
+            if (LEAVES_VALUE[production.symbols[k]]) table[p] = production.symbols[k] >= grammar::TERMINAL_COUNT;
+        }
+    }
+    return table;
+}
+constexpr auto PASS_THROUGH = buildPassThrough();
+
+// True when the productions of rule are exactly these right sides, in grammar order
+constexpr bool derives(uint16_t rule, std::initializer_list<std::initializer_list<uint16_t>> sides) {
+    const std::initializer_list<uint16_t>* side = sides.begin();
+    for (const grammar::Production& production : grammar::PRODUCTIONS) {
+        if (production.head != rule) continue;
+        if (side == sides.end() || side->size() != production.length) return false;
+        for (size_t k = 0; k < production.length; k++) {
+            if (production.symbols[k] != side->begin()[k]) return false;
+        }
+        side++;
+    }
+    return side == sides.end();
+}
+// True when these are the only terminals that leave a value
+constexpr bool onlyTerminalValues(std::initializer_list<uint16_t> terminals) {
+    for (uint16_t terminal = 0; terminal < grammar::TERMINAL_COUNT; terminal++) {
+        bool listed = false;
+        for (uint16_t value : terminals) listed = listed || value == terminal;
+        if (LEAVES_VALUE[terminal] != listed) return false;
+    }
+    return true;
+}
+// True when every production of rule passes its value through (Parser::reduce() has no case for it)
+constexpr bool passesThrough(uint16_t rule) {
+    for (size_t p = 0; p < std::size(grammar::PRODUCTIONS); p++) {
+        if (grammar::PRODUCTIONS[p].head == rule && !PASS_THROUGH[p]) return false;
+    }
+    return true;
+}
+// Parser::reduce() reads each action's values by position (v[k]), so the grammar it was written
+// for is checked here: a change to GRAMATICA.txt that moves a value fails the build until the
+// action is updated with it.
+namespace shape {
+using namespace grammar;
+static_assert(std::size(PRODUCTIONS) < NO_PRODUCTION, "TABLE is uint8_t and NO_PRODUCTION is 0xFF");
+static_assert(derives(PROGRAM, { { STATEMENT, PROGRAM }, {} }), "reduce(): program -> statement program | ''");
+static_assert(passesThrough(STATEMENT) && passesThrough(COMMAND), "reduce(): statement and command pass through");
+static_assert(derives(ASSIGN, { { LET, ID, ASSIGN_OP, EXPRESSION, SEMICOLON } }), "reduce(): assign");
+static_assert(derives(EXTRACT_FRAME, { { FRAME_KEY, EXPRESSION, EXPRESSION, TO, STRING, SEMICOLON } }), "reduce(): extract_frame");
+static_assert(derives(CONCATENATE, { { CONCAT_KEY, EXPRESSION, EXPRESSION, TO, STRING, SEMICOLON } }), "reduce(): concatenate");
+static_assert(derives(EXTRACT_AUDIO, { { AUDIO_KEY, EXPRESSION, EXPRESSION, EXPRESSION, TO, STRING, SEMICOLON } }),
+    "reduce(): extract_audio");
+static_assert(derives(PLAY, { { PLAY_KEY, EXPRESSION, PLAY_ARGS } }), "reduce(): play");
+static_assert(derives(PLAY_ARGS, { { SEMICOLON }, { EXPRESSION, EXPRESSION, SEMICOLON } }), "reduce(): play_args");
+static_assert(derives(IF_STMT, { { IF, CONDITION, THEN, STATEMENT } }), "reduce(): if_stmt");
+static_assert(derives(CONDITION, { { EXPRESSION, EQUALS, EXPRESSION } }), "reduce(): condition");
+// A tail action's left operand is the value just below its own: the product or term before it
+static_assert(derives(EXPRESSION, { { PRODUCT, EXPRESSION_TAIL } }), "reduce(): expression");
+static_assert(derives(EXPRESSION_TAIL, { { ADD_OP, PRODUCT, EXPRESSION_TAIL }, {} }), "reduce(): expression'");
+static_assert(derives(PRODUCT, { { TERM, PRODUCT_TAIL } }), "reduce(): product");
+static_assert(derives(PRODUCT_TAIL, { { MUL_OP, TERM, PRODUCT_TAIL }, {} }), "reduce(): product'");
+static_assert(derives(TERM, { { INT }, { STRING }, { TIME }, { ID }, { OPEN_PAR, EXPRESSION, CLOSE_PAR } }), "reduce(): term");
+// The values those positions count: operands and operators leave one, keywords and punctuation none
+static_assert(onlyTerminalValues({ ID, STRING, INT, TIME, ADD_OP, MUL_OP }), "reduce(): terminals that leave a value");
+static_assert(!LEAVES_VALUE[PROGRAM] && !LEAVES_VALUE[EXPRESSION_TAIL] && !LEAVES_VALUE[PRODUCT_TAIL] &&
+    LEAVES_VALUE[PLAY_ARGS] && LEAVES_VALUE[CONDITION], "reduce(): rules that leave a value");
+}
+
+class Parser {
+    // Tokens are pulled on demand, from a Lexer, a borrowed token vector, a TokenStream or a ring
+    Lexer* lexer = nullptr;
+    const std::vector<Token>* tokens = nullptr;
+    const TokenStream* stream = nullptr;
+    SpscRing<Token>* ring = nullptr;
+    Token ringLast{ TokenType::EOP, 0, "" };
+    size_t next = 0;
+    size_t literalCursor = 0; // Of stream: literalValues slot of the next INT/TIME token
+    uint32_t currentLiteral = 0; // Of stream: literalValues slot of current when it is INT/TIME
+    std::vector<Token> kept; // Tokens the tree refers to, for sources that can't be read back
+    uint32_t currentIndex = 0; // Position of current in tokens/stream
+    Token current{};  // LookAhead(1)
+    LineIndex sourceLines;
+    const LineIndex* lines = &sourceLines;
+    SymbolTable ownSymbols;
+    SymbolTable* symbols = &ownSymbols;
+    bool internAll = false; // Symbol IDs of the tokens are from another table: ignore them
+    std::vector<Value> variables; // Indexed by symbol ID
+    std::vector<bool> assigned;
+    std::vector<ScannerError> errors;
+    Arena arena; // The tree, see parse()
+    // Work stacks of evaluate() and writeExpr(), which walk expression trees without recursion:
+    // a subtree still to visit, or an operator whose operands are done / written
+    enum class ExprStep : uint8_t { TREE, OPERATOR, CLOSE };
+    struct ExprWork {
+        ExprStep step;
+        int outer; // writeExpr(): binding power the subtree must beat to go without parentheses
+        Expr expr;
+    };
+    std::vector<ASTNode*> programStatements; // Scratch buffers
+    std::vector<ExprWork> pending;
+    std::vector<Value> operands;
+    mutable std::vector<ExprWork> writing;
+    std::vector<uint16_t> stack; // Parse stack: symbols and actions, see parseProgram()
+    std::vector<ParseValue> values;
+    uint32_t statementStart = 0;
+
+    //PANIC MODE FUNCTIONS
+
+    // Next token from the active source (the final EOP repeats at the end)
+    Token pull() {
+        Token token = pullRaw();
+        // Tokens scanned without a table are interned here
+        if ((token.type == TokenType::ID || token.type == TokenType::STRING) && (token.symbol == SymbolTable::NO_SYMBOL || internAll)) {
+            token.symbol = symbols->intern(token.value);
+        }
+        return token;
+    }
+    Token pullRaw() {
+        if (lexer) return lexer->gettoken();
+        if (ring) {
+            // Once the producer has closed the ring, its last token (EOP) repeats
+            ring->pop(ringLast);
+            return ringLast;
+        }
+        size_t size = stream ? stream->size() : tokens->size();
+        if (size == 0) return Token{ TokenType::EOP, 0, "" };
+        bool fresh = next < size;
+        if (fresh) next++;
+        currentIndex = static_cast<uint32_t>(next - 1);
+        if (!stream) return (*tokens)[currentIndex];
+        // Pulled in order, so the stream's literals are read with a cursor instead of a search
+        if (!fresh) return stream->token(currentIndex);
+        size_t slot = literalCursor;
+        Token token = stream->token(currentIndex, literalCursor);
+        if (literalCursor != slot) currentLiteral = static_cast<uint32_t>(slot);
+        return token;
+    }
+    // Index that kind(), text() and number() read a matched token back with: its position in a
+    // borrowed vector or stream, or a copy in kept when the tokens are only pulled once (Lexer, ring)
+    uint32_t reference(const Token& token, uint32_t index) {
+        if (tokens || stream) return index;
+        kept.push_back(token);
+        return static_cast<uint32_t>(kept.size() - 1);
+    }
+    // What an ExprNode refers to, read back by index without rebuilding the Token
+    TokenType kind(uint32_t index) const {
+        if (tokens) return (*tokens)[index].type;
+        if (stream) return stream->kind(index);
+        return kept[index].type;
+    }
+    std::string_view text(uint32_t index) const {
+        if (tokens) return (*tokens)[index].value;
+        if (stream) return stream->text(index);
+        return kept[index].value;
+    }
+    uint32_t offset(uint32_t index) const {
+        if (tokens) return (*tokens)[index].offset;
+        if (stream) return stream->offsets[index];
+        return kept[index].offset;
+    }
+    // Decoded value of an INT or TIME leaf
+    int64_t number(Expr leaf) const {
+        if (tokens) return (*tokens)[leaf->token].number;
+        if (stream) return stream->literalValues[leaf->value];
+        return kept[leaf->token].number;
+    }
+    const Value* variable(uint32_t symbol) const {
+        return symbol < assigned.size() && assigned[symbol] ? &variables[symbol] : nullptr;
+    }
+    void assign(uint32_t symbol, const Value& value) {
+        if (symbol >= assigned.size()) {
+            variables.resize(symbols->size());
+            assigned.resize(symbols->size());
+        }
+        variables[symbol] = value;
+        assigned[symbol] = true;
+    }
+    // Check if token matches type without advancing
+    bool check(TokenType type) const {
+        return current.type == type;
+    }
+    // Advance to next token
+    void advance() {
+        current = pull();
+    }
+    // Synchronize to next statement or EOP
+    void synchronize() {
+        while (current.type != TokenType::EOP) {
+            if (current.type == TokenType::SEMICOLON) {
+                advance(); // Move past semicolon
+                return;
+            }
+            uint16_t terminal = grammar::terminalOf(current);
+            if (terminal < grammar::TERMINAL_COUNT &&
+                grammar::TABLE[grammar::STATEMENT - grammar::TERMINAL_COUNT][terminal] != grammar::NO_PRODUCTION) {
+                return; // Ready for next statement (let, if or a command)
+            }
+            advance();
+        }
+    }
+
+    //PARSER FUNCTIONS
+    void expected(TokenType type) {
+        errors.push_back({ current.offset, "UnexpectedToken",
+                          "Expected " + TokenTypeLiteral[(int)type] + ", got " +
+                          (current.value.empty() ? std::string("EOF") : current.str()) });
+        synchronize();
+    }
+
+    Value operand(Expr leaf) {
+        TokenType type = kind(leaf->token);
+        if (type == TokenType::INT) {
+            int64_t number = this->number(leaf); // Decoded by the scanner (INT64_MAX past its range)
+            if (number > INT_MAX) {
+                std::string digits(text(leaf->token));
+                errors.push_back({ offset(leaf->token), "IntegerOutOfRange", "Integer out of range: " + digits,
+                    static_cast<uint32_t>(digits.size()) });
+                throw std::out_of_range("Integer out of range: " + digits);
+            }
+            return Value(static_cast<int>(number));
+        }
+        if (type == TokenType::STRING) return Value(std::string(symbols->text(leaf->value)));
+        if (type == TokenType::TIME) return Value(TimePosition::fromMilliseconds(number(leaf)));
+        if (type == TokenType::ID) {
+            if (const Value* value = variable(leaf->value)) return *value;
+        }
+        std::string name(text(leaf->token));
+        errors.push_back({ offset(leaf->token), "UnknownIdentifier", "Unknown identifier: " + name });
+        throw std::runtime_error("Unknown identifier: " + name);
+    }
+    // Post-order over both sides with the pending stack, so neither long chains (left-deep)
+    // nor deep parentheses (right-deep) can run out of call stack
+    Value evaluate(Expr root) {
+        if (!root->left) return operand(root);
+        pending.clear(); // Left over when an evaluation threw
+        operands.clear();
+        pending.push_back({ ExprStep::TREE, 0, root });
+        while (!pending.empty()) {
+            ExprWork work = pending.back();
+            pending.pop_back();
+            if (work.step == ExprStep::OPERATOR) {
+                // Its left side is on operands, and so is its right side unless that is a leaf
+                Expr right = work.expr->right;
+                if (!right->left) {
+                    apply(work.expr->token, operands.back(), operand(right));
+                    continue;
+                }
+                Value rhs = std::move(operands.back());
+                operands.pop_back();
+                apply(work.expr->token, operands.back(), rhs);
+                continue;
+            }
+            // Down the left side: each operator waits for its right side, which runs first
+            Expr expr = work.expr;
+            for (; expr->left; expr = expr->left) {
+                pending.push_back({ ExprStep::OPERATOR, 0, expr });
+                if (expr->right->left) pending.push_back({ ExprStep::TREE, 0, expr->right });
+            }
+            operands.push_back(operand(expr));
+        }
+        return std::move(operands.back());
+    }
+    // result = result op rhs, op being the index of the operator token
+    void apply(uint32_t op, Value& result, const Value& rhs) {
+        if (kind(op) == TokenType::ADD_OP) {
+            if (result.type == Value::STRING && rhs.type == Value::STRING) {
+                result.str += rhs.str;
+            }
+            else if (result.type == Value::TIME && rhs.type == Value::TIME) {
+                if (!TimePosition::add(result.time, rhs.time, result.time)) timeOverflow(op);
+            }
+            else {
+                errors.push_back({ offset(op), "TypeError", "Invalid + operands" });
+                throw std::runtime_error("Invalid + operands");
+            }
+        }
+        else {
+            if (result.type == Value::TIME && rhs.type == Value::NUMBER) {
+                if (!TimePosition::multiply(result.time, rhs.num, result.time)) timeOverflow(op);
+            }
+            else if (result.type == Value::NUMBER && rhs.type == Value::TIME) {
+                TimePosition product;
+                if (!TimePosition::multiply(rhs.time, result.num, product)) timeOverflow(op);
+                result = Value(product);
+            }
+            else {
+                errors.push_back({ offset(op), "TypeError", "Multiplication only defined for time * number" });
+                throw std::runtime_error("Multiplication only defined for time * number");
+            }
+        }
+    }
+
+    // A time sum or product too long for TimePosition, at the operator token op
+    void timeOverflow(uint32_t op) {
+        errors.push_back({ offset(op), "TimeOverflow", "Time out of range" });
+        throw std::runtime_error("Time out of range");
+    }
+
+    // Builds a node in the arena
+    template <typename Payload>
+    ASTNode* node(const Payload& payload) {
+        return arena.make<ASTNode>(payload);
+    }
+
+    /*
+    Predictive parsing with the table of ParseTable.h (generated from GRAMATICA.txt) and an
+    explicit stack instead of one C++ call per rule: a rule on top of the stack is replaced
+    by the production TABLE picks for the current token, a terminal is matched against it,
+    and an action (SYMBOL_COUNT + production) runs once a production's symbols are all matched.
+
+    Finished rules and the tokens an action reads (names, literals, operators; not keywords
+    or punctuation) leave a ParseValue on values: an index into the token source, not a copy
+    of the token. The action of the production replaces them with the result (a node or an
+    expression tree). A production whose last symbol is its own rule (tail, e.g.
+    "expression' -> + product expression'") keeps the rule below its action, so it loops:
+    each round folds into the value before it, which builds a + b + c left-deep and keeps
+    both stacks flat however long the chain is. Only nesting ("if ... then if ...",
+    parentheses) makes them grow, on the heap.
+
+    Statements are the unit of error recovery: the failed one is replaced by an ErrorNode,
+    the input is synchronized to the next statement and parsing restarts from START.
+    */
+    const ASTNode& parseProgram() {
+        programStatements.clear();
+        recover(false);
+        for (;;) {
+            try {
+                drive();
+                break;
+            }
+            catch (...) {
+                synchronize(); // An evaluation failed (its error is on errors): the statement is dropped
+                recover(false);
+            }
+        }
+        if (check(TokenType::EOP)) advance();
+        tracer().flush();
+        return *node(ProgramNode{ arena.slice(programStatements) });
+    }
+    void drive() {
+        using namespace grammar;
+        uint16_t terminal = terminalOf(current);
+        while (!stack.empty()) {
+            uint16_t top = stack.back();
+            stack.pop_back();
+            if (top < TERMINAL_COUNT) {
+                if (top == terminal) {
+                    if (LEAVES_VALUE[top]) values.push_back(matched());
+                    advance();
+                }
+                else {
+                    expected(TERMINAL_TYPES[top]);
+                    recover(true);
+                }
+                terminal = terminalOf(current);
+            }
+            else if (top < SYMBOL_COUNT) {
+                if (top == START) statementStart = current.offset;
+                uint8_t p = terminal < TERMINAL_COUNT ? TABLE[top - TERMINAL_COUNT][terminal] : NO_PRODUCTION;
+                if (p == NO_PRODUCTION && top != START) p = emptyProduction(top); // Let the next symbol report the error
+                if (p == NO_PRODUCTION) {
+                    reject(top);
+                    recover(true);
+                    terminal = terminalOf(current);
+                    continue;
+                }
+                const Production& production = PRODUCTIONS[p];
+                if (production.length == 0) continue;
+                size_t count = production.length;
+                if (production.tail) {
+                    stack.push_back(top);
+                    count--;
+                }
+                if (!PASS_THROUGH[p]) stack.push_back(SYMBOL_COUNT + p);
+                // TABLE only picks a production that starts with a terminal for that very
+                // token, so it is matched here instead of going through the stack
+                bool leading = production.symbols[0] < TERMINAL_COUNT;
+                while (count > (leading ? 1 : 0)) stack.push_back(production.symbols[--count]);
+                if (leading) {
+                    if (LEAVES_VALUE[terminal]) values.push_back(matched());
+                    advance();
+                    terminal = terminalOf(current);
+                }
+            }
+            else reduce(top - SYMBOL_COUNT);
+        }
+    }
+    // What the current token leaves on values
+    ParseValue matched() {
+        ParseValue value;
+        value.token = reference(current, currentIndex);
+        bool literal = current.type == TokenType::INT || current.type == TokenType::TIME;
+        value.value = literal ? currentLiteral : current.symbol;
+        return value;
+    }
+    // Drops the statement being parsed, with an ErrorNode in its place when placeholder is set
+    void recover(bool placeholder) {
+        stack.assign(1, grammar::START);
+        values.clear();
+        if (placeholder) statement(node(ErrorNode{}), statementStart);
+    }
+    uint8_t emptyProduction(uint16_t rule) const {
+        for (uint8_t p = 0; p < std::size(grammar::PRODUCTIONS); p++) {
+            if (grammar::PRODUCTIONS[p].head == rule && grammar::PRODUCTIONS[p].length == 0) return p;
+        }
+        return grammar::NO_PRODUCTION;
+    }
+    // No production of rule starts with the current token
+    void reject(uint16_t rule) {
+        if (rule == grammar::PROGRAM || rule == grammar::STATEMENT) {
+            errors.push_back({ current.offset, "InvalidStatement", "Expected let, if, or command" });
+        }
+        else {
+            errors.push_back({ current.offset, "InvalidExpression", "Expected number, string, time, or identifier" });
+        }
+        synchronize();
+    }
+    // A top-level statement is done
+    void statement(ASTNode* stmt, uint32_t start) {
+        programStatements.push_back(stmt);
+        if (tracer().enabled(TraceLevel::TRACE)) {
+            SourcePosition pos = lines->locate(start);
+            Tracer::Record record = tracer().record(TraceLevel::TRACE, "PARSE");
+            std::string_view command = NodeKindName[static_cast<int>(stmt->kind())];
+            record << command << " statement at (" << pos.line << ":" << pos.charPos << ")";
+            record.field("command", command).field("line", pos.line).field("col", pos.charPos);
+        }
+    }
+    // Replaces the last count values with the first of them (or a new one when count is 0),
+    // for the action to fill in
+    ParseValue& fold(size_t count) {
+        values.resize(values.size() - count + 1);
+        return values.back();
+    }
+
+    // Action of production p. Its values are the last VALUE_COUNT[p] ones on values, one per
+    // symbol that leaves a value (LEAVES_VALUE); a tail production also folds them into the
+    // value before them, its left side.
+    void reduce(uint16_t p) {
+        using namespace grammar;
+        const Production& production = PRODUCTIONS[p];
+        size_t count = VALUE_COUNT[p];
+        ParseValue* v = values.data() + values.size() - count;
+        switch (production.head) {
+        case PROGRAM: // statement program
+            statement(v[0].node, statementStart);
+            values.pop_back();
+            break;
+        case ASSIGN: { // let ID = expression ;
+            uint32_t variable = v[0].value;
+            Expr value = v[1].expr;
+            assign(variable, evaluate(value));
+            fold(count).node = node(LetNode{ variable, value });
+            break;
+        }
+        case EXTRACT_FRAME: { // frame expression expression to string ;
+            ASTNode* frame = node(FrameNode{ v[0].expr, v[1].expr, v[2].value });
+            fold(count).node = frame;
+            break;
+        }
+        case CONCATENATE: { // concat expression expression to string ;
+            ASTNode* concat = node(ConcatNode{ v[0].expr, v[1].expr, v[2].value });
+            fold(count).node = concat;
+            break;
+        }
+        case EXTRACT_AUDIO: { // audio expression expression expression to string ;
+            ASTNode* audio = node(AudioNode{ v[0].expr, v[1].expr, v[2].expr, v[3].value });
+            fold(count).node = audio;
+            break;
+        }
+        case PLAY: { // play expression play_args
+            ASTNode* play = node(PlayNode{ v[0].expr, v[1].expr, v[1].second });
+            fold(count).node = play;
+            break;
+        }
+        case PLAY_ARGS: { // ; (the whole file, an empty value) | expression expression ;
+            Expr end = count > 0 ? v[1].expr : nullptr;
+            fold(count).second = end;
+            break;
+        }
+        case IF_STMT: { // if condition then statement
+            ASTNode* ifStmt = node(IfNode{ v[0].expr, v[0].second, v[1].node });
+            fold(count).node = ifStmt;
+            break;
+        }
+        case CONDITION: { // expression == expression
+            Expr right = v[1].expr;
+            fold(count).second = right;
+            break;
+        }
+        case EXPRESSION_TAIL: // (left) + product expression'
+        case PRODUCT_TAIL: {  // (left) * term product'
+            Expr binary = arena.make<ExprNode>(v[0].token, SymbolTable::NO_SYMBOL, v[-1].expr, v[1].expr);
+            fold(count + 1).expr = binary;
+            break;
+        }
+        case TERM: // literal (the value of "( expression )" passes through)
+            v[0].expr = arena.make<ExprNode>(v[0].token, v[0].value);
+            break;
+        default:
+            break;
+        }
+    }
+
+    // Operands and operators separated by spaces, with the parentheses the grouping needs
+    std::string exprToString(Expr expr) const {
+        std::string result;
+        writeExpr(result, expr, 0);
+        return result;
+    }
+    void writeExpr(std::string& out, Expr root, int outer) const {
+        // In order with the writing stack, as evaluate() does. A node whose operator binds looser
+        // than the one above it (or than outer) is wrapped in parentheses; the right side of an
+        // operator must bind tighter than it, since operators group from the left.
+        writing.assign(1, { ExprStep::TREE, outer, root });
+        while (!writing.empty()) {
+            ExprWork work = writing.back();
+            writing.pop_back();
+            if (work.step == ExprStep::CLOSE) {
+                out += ')';
+            }
+            else if (work.step == ExprStep::OPERATOR) {
+                out += ' ';
+                out += text(work.expr->token);
+                out += ' ';
+            }
+            else if (!work.expr->left) {
+                out += text(work.expr->token);
+            }
+            else {
+                int own = precedence(kind(work.expr->token));
+                if (own < work.outer) {
+                    out += '(';
+                    writing.push_back({ ExprStep::CLOSE, 0, nullptr });
+                }
+                writing.push_back({ ExprStep::TREE, own + 1, work.expr->right });
+                writing.push_back({ ExprStep::OPERATOR, 0, work.expr });
+                writing.push_back({ ExprStep::TREE, own, work.expr->left });
+            }
+        }
+    }
+    // A time literal is written as its exact value (frame timecodes included), anything else as written
+    std::string timeToString(Expr expr, bool seconds) const {
+        if (expr->left || kind(expr->token) != TokenType::TIME) return exprToString(expr);
+        TimePosition time = TimePosition::fromMilliseconds(number(expr));
+        return seconds ? time.toSecondsString() : time.toString();
+    }
+    // The statement under an if is printed by the same call, in a loop: if chains of any
+    // length take no call stack (the program is the only node that recurses, once)
+    void printAST(const ASTNode& root, std::ofstream& out, const std::string& parent = "") const {
+        // Generate unique node ID to avoid name clashes
+        static int nodeCounter = 0;
+        std::string parentId = parent;
+        for (const ASTNode* next = &root; next;) {
+            const ASTNode& node = *next;
+            next = nullptr;
+            std::string nodeId = "node_" + std::to_string(nodeCounter++);
+            auto child = [&](const char* label, std::string_view text) {
+                out << "node_" << nodeCounter++ << " = Node(\"" << label << text << "\", parent=" << nodeId << ")\n";
+            };
+
+            // Write main command node
+            std::string_view commandName = node.kind() == NodeKind::INVALID ? "ERROR" : NodeKindName[static_cast<int>(node.kind())];
+            out << nodeId << " = Node(\"" << commandName << "\"";
+            if (!parentId.empty()) out << ", parent=" << parentId;
+            out << ")\n";
+
+            switch (node.kind()) {
+            case NodeKind::PROGRAM:
+                for (const ASTNode* stmt : node.as<ProgramNode>().statements) printAST(*stmt, out, nodeId);
+                break;
+            case NodeKind::LET: {
+                const LetNode& let = node.as<LetNode>();
+                child("var: ", symbols->text(let.variable));
+                child("expr: ", exprToString(let.value));
+                break;
+            }
+            case NodeKind::IF: {
+                const IfNode& ifStmt = node.as<IfNode>();
+                child("left: ", exprToString(ifStmt.left));
+                child("right: ", exprToString(ifStmt.right));
+                next = ifStmt.then;
+                break;
+            }
+            case NodeKind::FRAME: {
+                const FrameNode& frame = node.as<FrameNode>();
+                child("arg1: ", exprToString(frame.input));
+                child("arg2: ", exprToString(frame.frame));
+                child("dest: ", symbols->text(frame.destination));
+                break;
+            }
+            case NodeKind::CONCAT: {
+                const ConcatNode& concat = node.as<ConcatNode>();
+                child("arg1: ", exprToString(concat.first));
+                child("arg2: ", exprToString(concat.second));
+                child("dest: ", symbols->text(concat.destination));
+                break;
+            }
+            case NodeKind::AUDIO: {
+                const AudioNode& audio = node.as<AudioNode>();
+                child("arg1: ", exprToString(audio.input));
+                child("arg2: ", exprToString(audio.start));
+                child("arg3: ", exprToString(audio.end));
+                child("dest: ", symbols->text(audio.destination));
+                break;
+            }
+            case NodeKind::PLAY: {
+                const PlayNode& play = node.as<PlayNode>();
+                child("arg1: ", exprToString(play.input));
+                if (play.start) {
+                    child("arg2: ", exprToString(play.start));
+                    child("arg3: ", exprToString(play.end));
+                }
+                break;
+            }
+            case NodeKind::INVALID:
+                break;
+            }
+            parentId = nodeId;
+        }
+    }
+
+public:
+    // Borrows t, which must outlive the parser. source is only used to report line:col.
+    // Every name is interned into the parser's own table, whatever symbol IDs t carries.
+    Parser(const std::vector<Token>& t, std::string_view source) : tokens(&t), sourceLines(source), internAll(true) {
+        current = pull();
+    }
+    // For tokens from tokenize(source, errors, table): their symbol IDs are used as they are
+    // (tokens without one, e.g. from relex(), are interned into table)
+    Parser(const std::vector<Token>& t, std::string_view source, SymbolTable& table)
+        : tokens(&t), sourceLines(source), symbols(&table) {
+        current = pull();
+    }
+    // Pulls tokens from the lexer as parsing goes, so the whole token list is never built
+    Parser(Lexer& l) : lexer(&l), lines(&l.lines()) {
+        if (!l.symbolTable()) l.setSymbols(ownSymbols);
+        symbols = l.symbolTable();
+        current = pull();
+    }
+    // Reads kinds/offsets/lengths straight from the stream's arrays (borrowed, like the vector)
+    Parser(const TokenStream& s) : stream(&s), sourceLines(s.source) {
+        current = pull();
+    }
+    // Consumes tokens another thread pushes into r (see Pipeline.h). The producer must not
+    // intern symbols: the parser owns its table and interns the tokens itself.
+    Parser(SpscRing<Token>& r, std::string_view source) : ring(&r), sourceLines(source) {
+        current = pull();
+    }
+
+    // Parses without writing any output, for callers that only need the tree. The tree lives
+    // in the parser's arena (and its tokens point into the source): both must outlive it.
+    const ASTNode& parse() {
+        return parseProgram();
+    }
+    // Memory held by the tree
+    const Arena& memory() const {
+        return arena;
+    }
+    const std::vector<ScannerError>& getErrors() const {
+        return errors;
+    }
+    /*
+    void parseAndExecute() {
+        if (!errors.empty()) {
+            for (const auto& err : errors) {
+                std::cerr << "Error at line " << err.line << ", col " << err.charPos << ": " << err.type << " - " << err.message << "\n";
+            }
+            errors.clear();
+        }
+        ASTNode program = parseProgram();
+        if (!errors.empty()) {
+            for (const auto& err : errors) {
+                std::cerr << "Error at line " << err.line << ", col " << err.charPos << ": " << err.type << " - " << err.message << "\n";
+            }
+        }
+        else {
+            // Generate AST.txt if parsing succeeded
+            std::ofstream out("AST.py");
+            if (out.is_open()) {
+                out << "from anytree import Node\n\n";
+                printAST(program, out);
+                out.close();
+            }
+            //execute(program);
+        }
+    }
+    */
+    void reportErrors() const {
+        for (const auto& err : errors) {
+            SourcePosition pos = lines->locate(err.offset);
+            std::cerr << "Error at line " << pos.line << ", col " << pos.charPos;
+            if (err.length > 1) std::cerr << "-" << pos.charPos + err.length - 1;
+            std::cerr << ": " << err.type << " - " << err.message << "\n";
+        }
+    }
+    // Reads what a pulled source has left after the program (a '$' ends it early), so the
+    // scanner has seen the whole script and written all of its errors
+    void finishInput() {
+        if (lexer) {
+            while (!lexer->done()) lexer->gettoken();
+        }
+        if (ring) {
+            while (ring->pop(ringLast)) {}
+        }
+    }
+    // Parses, then writes AST.py and the Python script when neither scanErrors (the errors of
+    // the scanner that produced the tokens) nor the parser found an error. Returns whether it did.
+    bool parseAndExecute(const std::vector<ScannerError>& scanErrors = {}) {
+        if (!errors.empty()) {
+            reportErrors();
+            errors.clear();
+        }
+
+        const ASTNode& program = parseProgram();
+        finishInput();
+
+        reportScanErrors(scanErrors, *lines);
+        if (!errors.empty() || !scanErrors.empty()) {
+            reportErrors();
+            return false;
+        }
+        else {
+            // Write AST visualization (tree form)
+            std::ofstream treeOut("AST.py");
+            if (treeOut.is_open()) {
+                treeOut << "from anytree import Node\n\n";
+                printAST(program, treeOut);
+                treeOut.close();
+            }
+
+            // Write executable Python code
+            std::ofstream pyOut("generated_video_script.py");
+            if (pyOut.is_open()) {
+                translateToPython(program, pyOut);
+                pyOut.close();
+                std::cout << "Generated Python script: generated_video_script.py\n";
+            }
+            return true;
+        }
+    }
+
+    // Video Operations Python
+
+    // Like printAST(), the statement under an if is written in a loop, not by recursion
+    void translateToPython(const ASTNode& root, std::ofstream& out) {
+        for (const ASTNode* next = &root; next;) {
+            const ASTNode& node = *next;
+            next = nullptr;
+            switch (node.kind()) {
+            case NodeKind::PROGRAM:
+                out << "import ffmpeg\n";
+                out << "import subprocess\n\n";
+                for (const ASTNode* stmt : node.as<ProgramNode>().statements) {
+                    translateToPython(*stmt, out);
+                    out << "\n";
+                }
+                break;
+            case NodeKind::PLAY: {
+                const PlayNode& play = node.as<PlayNode>();
+                std::string file = exprToString(play.input);
+                out << "subprocess.run([\"vlc\", \"" << file << "\"";
+                if (play.start) {
+                    std::string start = timeToString(play.start, true);
+                    std::string end = timeToString(play.end, true);
+                    out << ", \"--start-time\", \"" << start << "\", \"--stop-time\", \"" << end << "\"";
+                }
+                out << "])\n";
+                break;
+            }
+            case NodeKind::FRAME: {
+                const FrameNode& frame = node.as<FrameNode>();
+                std::string input = exprToString(frame.input);
+                std::string frameNum = exprToString(frame.frame);
+                out << "ffmpeg.input(\"" << input << "\")"
+                    << ".filter(\"select\", \"eq(n\\\\," << frameNum << ")\")"
+                    << ".output(\"" << symbols->text(frame.destination) << "\", vframes=1).run()\n";
+                break;
+            }
+            case NodeKind::CONCAT: {
+                const ConcatNode& concat = node.as<ConcatNode>();
+                std::string input1 = exprToString(concat.first);
+                std::string input2 = exprToString(concat.second);
+                std::string_view dest = symbols->text(concat.destination);
+
+                out << "# Convert inputs\n";
+                out << "ffmpeg.input(\"" << input1 << "\").output(\"converted_0.mp4\", vcodec='libx264', acodec='aac').run()\n";
+                out << "ffmpeg.input(\"" << input2 << "\").output(\"converted_1.mp4\", vcodec='libx264', acodec='aac').run()\n\n";
+
+                out << "# Write concat file list\n";
+                out << "with open('files.txt', 'w') as f:\n";
+                out << "    f.write(\"file 'converted_0.mp4'\\n\")\n";
+                out << "    f.write(\"file 'converted_1.mp4'\\n\")\n\n";
+
+                out << "# Concatenate with concat demuxer\n";
+                out << "subprocess.run(['ffmpeg', '-f', 'concat', '-safe', '0', '-i', 'files.txt', '-c', 'copy', '" << dest << "'])\n";
+                break;
+            }
+            case NodeKind::AUDIO: {
+                const AudioNode& audio = node.as<AudioNode>();
+                std::string input = exprToString(audio.input);
+                std::string start = timeToString(audio.start, false);
+                std::string end = timeToString(audio.end, false);
+                std::string_view dest = symbols->text(audio.destination);
+
+                out << "ffmpeg.input(\"" << input << "\", ss=\"" << start << "\", to=\"" << end << "\")"
+                    << ".output(\"" << dest << "\", vn=None, acodec='mp3').run()\n";
+                break;
+            }
+            case NodeKind::IF: {
+                const IfNode& ifStmt = node.as<IfNode>();
+                std::string cond1 = exprToString(ifStmt.left);
+                std::string cond2 = exprToString(ifStmt.right);
+                out << "if " << cond1 << " == " << cond2 << ":\n";
+                out << "    ";
+                next = ifStmt.then;
+                break;
+            }
+            case NodeKind::LET:
+            case NodeKind::INVALID:
+                break;
+            }
+        }
+    }
+};
@@ -0,0 +1,63 @@
+#pragma once
+
+#include "Parser.h"
+#include <exception>
+#include <thread>
+
+//PIPELINED COMPILE
+/*
+The scanner and the parser run at the same time: a second thread runs the Lexer over the
+source and pushes every token into a bounded SpscRing, and the calling thread parses them
+as they arrive.
+
+- Backpressure: when the parser falls behind, the ring fills up and the lexer thread waits,
+  so memory stays at PIPELINE_CAPACITY tokens whatever the size of the script.
+- End of input: the lexer pushes its final EOP and closes the ring; the parser then keeps
+  reading that EOP, as with the other token sources.
+- The lexer always scans the whole source, as tokenize() does, so errors are the same as
+  in the sequential path. Only if parsing throws is the ring cancelled to stop it early.
+  Either way the thread is joined before pipelined() returns.
+
+The lexer thread interns nothing (SymbolTable is not thread safe): the Parser interns the
+tokens on its own thread. Scanner errors are written to errors, which must not be read
+until the lexer is done: after pipelined() returns, or inside run once the parser has read
+all of its input (Parser::finishInput(), which parseAndExecute(errors) calls before it
+reports them), since the lexer writes every error before it closes the ring.
+*/
+
+constexpr size_t PIPELINE_CAPACITY = 4096;
+
+// Returns run(parser), where parser reads the tokens of source while they are scanned
+template <typename Run>
+auto pipelined(std::string_view source, std::vector<ScannerError>& errors, Run run, size_t capacity = PIPELINE_CAPACITY,
+    const ScanOptions& options = {}) {
+    SpscRing<Token> ring(capacity);
+    std::thread scanner([&ring, &errors, source, options] {
+        Lexer lexer(source, errors);
+        lexer.setOptions(options);
+        bool open;
+        do {
+            open = ring.push(lexer.gettoken());
+        } while (open && !lexer.done());
+        ring.close();
+    });
+
+    // Joins on every way out. A parser that stops early (at a '$') still gets every scanner
+    // error, so the rest of the tokens are read and dropped; after a throw the lexer is stopped.
+    struct Join {
+        SpscRing<Token>& ring;
+        std::thread& thread;
+        int exceptions = std::uncaught_exceptions();
+        ~Join() {
+            if (std::uncaught_exceptions() > exceptions) ring.cancel();
+            else {
+                Token rest;
+                while (ring.pop(rest)) {}
+            }
+            thread.join();
+        }
+    } join{ ring, scanner };
+
+    Parser parser(ring, source);
+    return run(parser);
+}
@@ -0,0 +1,230 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define SCAN_KERNELS_AVX2 1
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SCAN_KERNELS_SSE2 1
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+//SCANNER KERNELS
+/*
+Vectorized searches used by the Lexer for the long runs it has to skip: whitespace,
+"#" comments (up to the newline), "##" comments (up to the closing ##) and string bodies
+(up to the closing quote). 32 bytes per step with AVX2, 16 with SSE2, and a scalar loop
+otherwise (and for the tail of every buffer). All of them return n when nothing is found.
+
+findByte(p, n, c)      - index of the first c
+findEither(p, n, a, b) - index of the first a or b
+findPair(p, n, c)      - index of the first "cc" (both bytes inside [0, n))
+skipSpaces(p, n)       - index of the first byte that is not a C-locale space
+asciiPrefix(p, n)      - index of the first byte >= 0x80
+*/
+namespace scan {
+
+inline unsigned lowestBit(uint32_t mask) {
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return index;
+#else
+    return static_cast<unsigned>(__builtin_ctz(mask));
+#endif
+}
+
+inline bool isSpaceByte(char c) {
+    return c == ' ' || (static_cast<unsigned char>(c) - 9u) <= 4u; // ' ', \t \n \v \f \r
+}
+
+#if defined(SCAN_KERNELS_AVX2)
+const size_t WIDTH = 32;
+typedef __m256i Block;
+inline Block load(const char* p) { return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)); }
+inline Block splat(char c) { return _mm256_set1_epi8(c); }
+inline uint32_t matches(Block b, Block c) { return static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(b, c))); }
+inline uint32_t highBits(Block b) { return static_cast<uint32_t>(_mm256_movemask_epi8(b)); }
+inline Block either(Block a, Block b) { return _mm256_or_si256(a, b); }
+inline uint32_t spaces(Block b) {
+    __m256i shifted = _mm256_sub_epi8(b, _mm256_set1_epi8(9));
+    __m256i ctrl = _mm256_cmpeq_epi8(_mm256_min_epu8(shifted, _mm256_set1_epi8(4)), shifted);
+    __m256i blank = _mm256_cmpeq_epi8(b, _mm256_set1_epi8(' '));
+    return static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_or_si256(ctrl, blank)));
+}
+const uint32_t ALL = 0xFFFFFFFFu;
+#elif defined(SCAN_KERNELS_SSE2)
+const size_t WIDTH = 16;
+typedef __m128i Block;
+inline Block load(const char* p) { return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)); }
+inline Block splat(char c) { return _mm_set1_epi8(c); }
+inline uint32_t matches(Block b, Block c) { return static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(b, c))); }
+inline uint32_t highBits(Block b) { return static_cast<uint32_t>(_mm_movemask_epi8(b)); }
+inline Block either(Block a, Block b) { return _mm_or_si128(a, b); }
+inline uint32_t spaces(Block b) {
+    __m128i shifted = _mm_sub_epi8(b, _mm_set1_epi8(9));
+    __m128i ctrl = _mm_cmpeq_epi8(_mm_min_epu8(shifted, _mm_set1_epi8(4)), shifted);
+    __m128i blank = _mm_cmpeq_epi8(b, _mm_set1_epi8(' '));
+    return static_cast<uint32_t>(_mm_movemask_epi8(_mm_or_si128(ctrl, blank)));
+}
+const uint32_t ALL = 0xFFFFu;
+#endif
+
+inline size_t findByte(const char* p, size_t n, char c) {
+    size_t i = 0;
+#if defined(SCAN_KERNELS_AVX2) || defined(SCAN_KERNELS_SSE2)
+    Block target = splat(c);
+    for (; i + WIDTH <= n; i += WIDTH) {
+        uint32_t mask = matches(load(p + i), target);
+        if (mask) return i + lowestBit(mask);
+    }
+#endif
+    for (; i < n; i++) {
+        if (p[i] == c) return i;
+    }
+    return n;
+}
+
+inline size_t findEither(const char* p, size_t n, char a, char b) {
+    size_t i = 0;
+#if defined(SCAN_KERNELS_AVX2) || defined(SCAN_KERNELS_SSE2)
+    Block first = splat(a);
+    Block second = splat(b);
+    for (; i + WIDTH <= n; i += WIDTH) {
+        Block block = load(p + i);
+        uint32_t mask = matches(block, first) | matches(block, second);
+        if (mask) return i + lowestBit(mask);
+    }
+#endif
+    for (; i < n; i++) {
+        if (p[i] == a || p[i] == b) return i;
+    }
+    return n;
+}
+
+inline size_t findPair(const char* p, size_t n, char c) {
+    size_t i = 0;
+#if defined(SCAN_KERNELS_AVX2) || defined(SCAN_KERNELS_SSE2)
+    Block target = splat(c);
+    for (; i + WIDTH + 1 <= n; i += WIDTH) {
+        uint32_t mask = matches(load(p + i), target) & matches(load(p + i + 1), target);
+        if (mask) return i + lowestBit(mask);
+    }
+#endif
+    for (; i + 1 < n; i++) {
+        if (p[i] == c && p[i + 1] == c) return i;
+    }
+    return n;
+}
+
+inline size_t skipSpaces(const char* p, size_t n) {
+    // Most runs are a single space between two tokens
+    if (n == 0 || !isSpaceByte(p[0])) return 0;
+    if (n == 1 || !isSpaceByte(p[1])) return 1;
+    size_t i = 2;
+#if defined(SCAN_KERNELS_AVX2) || defined(SCAN_KERNELS_SSE2)
+    for (; i + WIDTH <= n; i += WIDTH) {
+        uint32_t mask = ~spaces(load(p + i)) & ALL;
+        if (mask) return i + lowestBit(mask);
+    }
+#endif
+    for (; i < n; i++) {
+        if (!isSpaceByte(p[i])) return i;
+    }
+    return n;
+}
+
+inline size_t asciiPrefix(const char* p, size_t n) {
+    size_t i = 0;
+#if defined(SCAN_KERNELS_AVX2) || defined(SCAN_KERNELS_SSE2)
+    // Four blocks per test, the common case is a long run of plain ASCII
+    for (; i + 4 * WIDTH <= n; i += 4 * WIDTH) {
+        Block all = either(either(load(p + i), load(p + i + WIDTH)), either(load(p + i + 2 * WIDTH), load(p + i + 3 * WIDTH)));
+        if (highBits(all)) break;
+    }
+    for (; i + WIDTH <= n; i += WIDTH) {
+        uint32_t mask = highBits(load(p + i));
+        if (mask) return i + lowestBit(mask);
+    }
+#endif
+    for (; i < n; i++) {
+        if (static_cast<unsigned char>(p[i]) >= 0x80) return i;
+    }
+    return n;
+}
+
+//UTF-8 VALIDATION
+/*
+Checks text for well-formed UTF-8 (Unicode table 3-7: no overlong forms, no surrogates,
+nothing above U+10FFFF). ASCII runs are skipped with asciiPrefix(), so plain text goes at
+the speed of the loads; only the bytes of multi-byte sequences are looked at one by one.
+
+The state carries over between feed() calls, so text read in chunks can be checked piece
+by piece. After an error, pending()/byte() give the bytes of the broken sequence (the byte
+that broke it is the last one); call reset() to go on.
+*/
+class Utf8Check {
+    unsigned char bytes[4] = {};
+    uint8_t seen = 0;  // Bytes of the current sequence so far
+    uint8_t need = 0;  // Continuation bytes still missing
+    unsigned char lo = 0x80, hi = 0xBF; // Range of the next continuation byte
+
+public:
+    // Index of the byte that makes the text invalid, n when it is fine so far
+    size_t feed(const char* p, size_t n) {
+        size_t k = 0;
+        while (k < n) {
+            unsigned char c = static_cast<unsigned char>(p[k]);
+            if (need == 0) {
+                if (c < 0x80) {
+                    k += asciiPrefix(p + k, n - k);
+                    continue;
+                }
+                seen = 0;
+                lo = 0x80;
+                hi = 0xBF;
+                if (c >= 0xC2 && c <= 0xDF) need = 1;
+                else if (c == 0xE0) { need = 2; lo = 0xA0; }
+                else if (c == 0xED) { need = 2; hi = 0x9F; }
+                else if (c >= 0xE1 && c <= 0xEF) need = 2;
+                else if (c == 0xF0) { need = 3; lo = 0x90; }
+                else if (c == 0xF4) { need = 3; hi = 0x8F; }
+                else if (c >= 0xF1 && c <= 0xF3) need = 3;
+                bytes[seen++] = c;
+                if (need == 0) return k;
+            }
+            else {
+                bytes[seen++] = c;
+                if (c < lo || c > hi) return k;
+                need--;
+                lo = 0x80;
+                hi = 0xBF;
+            }
+            k++;
+        }
+        return n;
+    }
+    // False while a sequence is open (at the end of the text: it was cut short)
+    bool complete() const {
+        return need == 0;
+    }
+    // Bytes of the sequence being checked, or of the broken one after an error
+    size_t pending() const {
+        return seen;
+    }
+    unsigned char byte(size_t k) const {
+        return bytes[k];
+    }
+    void reset() {
+        seen = 0;
+        need = 0;
+    }
+};
+
+}
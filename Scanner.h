@@ -1,363 +1,1049 @@
-﻿#pragma once
-
-#include <iostream>
-#include <string>
-#include <vector>
-#include <cstdlib>
-#include <fstream>
-#include <sstream>
-#include <unordered_map>
-#include <algorithm>
-
-//GRAMMAR
-/*
-program        -> statement program'
-program'       -> statement program' | ε
-statement      -> assign | command | if_stmt
-assign         -> let ID = expression ;
-command        -> extract_frame | concatenate | extract_audio | play
-extract_frame  -> frame expression expression to string ;
-concatenate    -> concat expression expression to string ;
-extract_audio  -> audio expression expression expression to string ;
-play           -> play expression play_args
-play_args      -> ; | expression expression ;
-if_stmt        -> if condition then statement
-condition      -> expression == expression
-expression     -> term expression'
-expression'    -> + term expression' | * term expression' | ε
-term           -> number | string | time | ID
-string         -> STRING
-number         -> NUMBER
-time           -> TIME
-ID             -> IDENTIFIER
-*/
-
-//EXAMPLE
-/*
-frame "video.mp4" 5 to "frame5.bmp";              Extracts frame 5 as a bitmap.
-concat "clip1.mp4" "clip2.mp4" to "output.mp4";   Concatenates two clips.
-audio "video.mp4" 10 20 to "audio.mp3";           Extracts audio from 10s to 20s.
-play "video.mp4";                                 Plays the video.
-*/
-
-
-//STRUCT TO HAVE CONSISTENT TIME INPUT (MINUTES:SECONDS)
-struct TimePosition {
-    int minutes;
-    int seconds;
-    TimePosition(int min = 0, int seg = 0) : minutes(min), seconds(seg) {
-        normalize();
-    }
-    // Parse "MM:SS" format
-    explicit TimePosition(const std::string& timeStr) {
-        size_t colonPos = timeStr.find(':');
-        //string::npos - When used as the value for a len parameter in string's member functions, means "until the end of the string".
-        if (colonPos == std::string::npos) {
-            throw std::invalid_argument("Invalid time format: " + timeStr);
-        }
-        minutes = std::stoi(timeStr.substr(0, colonPos));
-        seconds = std::stoi(timeStr.substr(colonPos + 1));
-        normalize();
-    }
-    void normalize() {
-        if (seconds >= 60) {
-            minutes += seconds / 60;
-            seconds %= 60;
-        }
-        if (minutes < 0 || seconds < 0) {
-            throw std::invalid_argument("Time cannot be negative");
-        }
-    }
-    double toSeconds() const {
-        return minutes * 60.0 + seconds;
-    }
-    std::string toString() const {
-        return std::to_string(minutes) + ":" + (seconds < 10 ? "0" : "") + std::to_string(seconds);
-    }
-    TimePosition operator+(const TimePosition& other) const {
-        return TimePosition(toSeconds() + other.toSeconds());
-    }
-    TimePosition operator*(int n) const {
-        return TimePosition(toSeconds() * n);
-    }
-    bool operator==(const TimePosition& other) const {
-        return toSeconds() == other.toSeconds();
-    }
-
-};
-
-// Updated TokenType enum
-enum class TokenType {
-    ID, ASSIGN_OP, INT, ADD_OP, MUL_OP, PRINT_KEY, OPEN_PAR, CLOSE_PAR, EOP,
-    KEYWORD, STRING, NUMBER, TIME, SEMICOLON, TO, LET, IF, THEN, EQUALS, END
-};
-
-std::string TokenTypeLiteral[] = {
-    "ID", "ASSIGN_OP", "INT", "ADD_OP", "MUL_OP", "PRINT_KEY", "OPEN_PAR", "CLOSE_PAR", "EOP",
-    "KEYWORD", "STRING", "NUMBER", "TIME", "SEMICOLON", "TO", "LET", "IF", "THEN", "EQUALS", "END"
-};
-struct Token {
-    TokenType type;
-    std::string value;
-    int line;
-    int charPos;
-};
-
-//STRUCT TO MARK ERRORS IN THE SCANNER
-struct ScannerError {
-    int line;
-    int charPos;
-    std::string type;
-    std::string message;
-};
-
-std::vector<Token> tokenize(const std::string& source, std::vector<ScannerError>& errors) {
-    std::vector<Token> tokens;
-    size_t i = 0;
-    int currentLine = 1;
-    int charPosInLine = 1;
-
-    while (i < source.length()) {
-        if (source[i] == '\n') {
-            currentLine++;
-            charPosInLine = 1;
-            i++;
-            continue;
-        }
-        if (std::isspace(source[i])) {
-            charPosInLine++;
-            i++;
-            continue;
-        }
-
-        // Comments
-        if (source[i] == '#') {
-            i++;
-            charPosInLine++;
-            if (i < source.length() && source[i] == '#') {
-                i++;
-                charPosInLine++;
-                bool foundEnd = false;
-                while (i < source.length() - 1) {
-                    if (source[i] == '\n') {
-                        currentLine++;
-                        charPosInLine = 1;
-                    }
-                    else {
-                        charPosInLine++;
-                    }
-                    if (source[i] == '#' && source[i + 1] == '#') {
-                        i += 2;
-                        charPosInLine += 2;
-                        foundEnd = true;
-                        break;
-                    }
-                    i++;
-                }
-                if (!foundEnd) {
-                    errors.push_back({ currentLine, charPosInLine, "UnterminatedComment", "Unterminated multi-line comment" });
-                }
-            }
-            else {
-                while (i < source.length() && source[i] != '\n') {
-                    i++;
-                    charPosInLine++;
-                }
-            }
-            continue;
-        }
-        /*
-        // Keyword or identifier
-        if (std::isalpha(source[i])) {
-            std::string word;
-            int startPos = charPosInLine;
-            while (i < source.length() && std::isalnum(source[i])) {
-                word += source[i++];
-                charPosInLine++;
-            }
-            if (word == "print") {
-                tokens.push_back({ TokenType::PRINT_KEY, word, currentLine, startPos });
-            }
-            else if (word == "to") tokens.push_back({ TokenType::TO,  word, currentLine, startPos });
-            else if (word == "let" || word == "frame" || word == "concat" || word == "audio" || word == "play") {
-                tokens.push_back({ TokenType::KEYWORD,  word, currentLine, startPos });
-            }
-            else if (word == "if") tokens.push_back({ TokenType::IF, word , currentLine, startPos });
-            else if (word == "then") tokens.push_back({ TokenType::THEN,  word, currentLine, startPos });
-            else tokens.push_back({ TokenType::ID,  word, currentLine, startPos });
-            continue;
-        }
-        */
-        // Identifiers and keywords
-        if (std::isalpha(source[i])) {
-            std::string word;
-            int startPos = charPosInLine;
-            while (i < source.length() && std::isalnum(source[i])) {
-                word += source[i++];
-                charPosInLine++;
-            }
-            if (word == "print") {
-                tokens.push_back({ TokenType::PRINT_KEY, word, currentLine, startPos });
-            }
-            else if (word == "let") {
-                tokens.push_back({ TokenType::LET, word, currentLine, startPos });
-            }
-            else if (word == "if") {
-                tokens.push_back({ TokenType::IF, word, currentLine, startPos });
-            }
-            else if (word == "then") {
-                tokens.push_back({ TokenType::THEN, word, currentLine, startPos });
-            }
-            else if (word == "to") {
-                tokens.push_back({ TokenType::TO, word, currentLine, startPos });
-            }
-            else if (word == "frame" || word == "concat" || word == "audio" || word == "play") {
-                tokens.push_back({ TokenType::KEYWORD, word, currentLine, startPos });
-            }
-            else {
-                tokens.push_back({ TokenType::ID, word, currentLine, startPos });
-            }
-            continue;
-        }
-        if (source[i] == '"') {
-            std::string str;
-            int startPos = charPosInLine;
-            i++;
-            charPosInLine++;
-            int startLine = currentLine;
-            while (i < source.length() && source[i] != '"') {
-                if (source[i] == '\n') {
-                    currentLine++;
-                    charPosInLine = 1;
-                }
-                else {
-                    charPosInLine++;
-                }
-                str += source[i++];
-            }
-            if (i >= source.length()) {
-                errors.push_back({ startLine, startPos, "UnclosedString", "Unclosed string literal" });
-                continue;
-            }
-            i++;
-            charPosInLine++;
-            if (str.find(':') != std::string::npos) {
-                try {
-                    TimePosition time(str);
-                    tokens.push_back({ TokenType::TIME, str, startLine, startPos });
-                }
-                catch (const std::exception& e) {
-                    errors.push_back({ startLine, startPos, "InvalidTime", "Invalid time format: " + str });
-                }
-            }
-            else {
-                if (str.empty()) {
-                    errors.push_back({ startLine, startPos, "EmptyString", "Empty string literal" });
-                }
-                else {
-                    tokens.push_back({ TokenType::STRING, str, startLine, startPos });
-                }
-            }
-            continue;
-        }
-
-        // Number (INT)
-        if (std::isdigit(source[i])) {
-            std::string num;
-            int startPos = charPosInLine;
-            while (i < source.length() && std::isdigit(source[i])) {
-                num += source[i++];
-                charPosInLine++;
-            }
-            tokens.push_back({ TokenType::INT, num, currentLine, startPos });
-            continue;
-        }
-
-        // Operators
-        if (source[i] == '=') {
-            if (i + 1 < source.length() && source[i + 1] == '=') {
-                tokens.push_back({ TokenType::EQUALS, "==", currentLine, charPosInLine });
-                i += 2;
-                charPosInLine += 2;
-            }
-            else {
-                tokens.push_back({ TokenType::ASSIGN_OP, "=", currentLine, charPosInLine });
-                i++;
-                charPosInLine++;
-            }
-            continue;
-        }
-        if (source[i] == '+') {
-            tokens.push_back({ TokenType::ADD_OP, "+", currentLine, charPosInLine });
-            i++;
-            charPosInLine++;
-            continue;
-        }
-        if (source[i] == '*') {
-            tokens.push_back({ TokenType::MUL_OP, "*", currentLine, charPosInLine });
-            i++;
-            charPosInLine++;
-            continue;
-        }
-        if (source[i] == '(') {
-            tokens.push_back({ TokenType::OPEN_PAR, "(", currentLine, charPosInLine });
-            i++;
-            charPosInLine++;
-            continue;
-        }
-        if (source[i] == ')') {
-            tokens.push_back({ TokenType::CLOSE_PAR, ")", currentLine, charPosInLine });
-            i++;
-            charPosInLine++;
-            continue;
-        }
-        if (source[i] == ';') {
-            tokens.push_back({ TokenType::SEMICOLON, ";", currentLine, charPosInLine });
-            i++;
-            charPosInLine++;
-            continue;
-        }
-        if (source[i] == '$') {
-            tokens.push_back({ TokenType::EOP, "$", currentLine, charPosInLine });
-            i++;
-            charPosInLine++;
-            continue;
-        }
-
-        // Invalid character
-        errors.push_back({ currentLine, charPosInLine, "InvalidCharacter", "Unexpected character: " + std::string(1, source[i]) });
-        i++;
-        charPosInLine++;
-    }
-    tokens.push_back({ TokenType::EOP, "", currentLine, charPosInLine });
-    return tokens;
-}
-bool scanAndLog(const std::string& source) {
-    std::cout << "INFO SCAN - Start scanningc\n";
-    std::vector<ScannerError> errors;
-    auto tokens = tokenize(source, errors);
-
-    for (const auto& token : tokens) {
-        if (token.type != TokenType::EOP || !token.value.empty()) {
-            std::cout << "DEBUG SCAN - " << TokenTypeLiteral[(int)token.type]
-                << " [ " << token.value << " ] found at ("
-                << token.line << ":" << token.charPos << ")\n";
-        }
-    }
-
-    if (errors.empty()) {
-        std::cout << "INFO SCAN - Completed with 0 errors\n";
-        return true;
-    }
-    else {
-        std::cout << "INFO SCAN - Completed with " << errors.size() << " errors\n";
-        for (const auto& err : errors) {
-            std::cerr << "ERROR SCAN - Line " << err.line << ":" << err.charPos
-                << ", type: " << err.type << " - " << err.message << "\n";
-        }
-        return false;
-    }
-}
-
-
-
+﻿#pragma once
+
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <array>
+#include <cstdint>
+#include <climits>
+#include <charconv>
+#include <vector>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <unordered_map>
+#include <algorithm>
+#include <memory>
+#include <cstdio>
+
+#include "SourceInput.h"
+#include "ScanKernels.h"
+#include "Trace.h"
+
+//GRAMMAR
+/*
+program        -> statement program'
+program'       -> statement program' | ε
+statement      -> assign | command | if_stmt
+assign         -> let ID = expression ;
+command        -> extract_frame | concatenate | extract_audio | play
+extract_frame  -> frame expression expression to string ;
+concatenate    -> concat expression expression to string ;
+extract_audio  -> audio expression expression expression to string ;
+play           -> play expression play_args
+play_args      -> ; | expression expression ;
+if_stmt        -> if condition then statement
+condition      -> expression == expression
+expression     -> term expression'
+expression'    -> + term expression' | * term expression' | ε
+term           -> number | string | time | ID
+string         -> STRING
+number         -> NUMBER
+time           -> TIME
+ID             -> IDENTIFIER
+*/
+
+//EXAMPLE
+/*
+frame "video.mp4" 5 to "frame5.bmp";              Extracts frame 5 as a bitmap.
+concat "clip1.mp4" "clip2.mp4" to "output.mp4";   Concatenates two clips.
+audio "video.mp4" 10 20 to "audio.mp3";           Extracts audio from 10s to 20s.
+play "video.mp4";                                 Plays the video.
+*/
+
+
+//STRUCT TO HAVE CONSISTENT TIME INPUT
+// A whole number of milliseconds, so sums, products and comparisons are exact and the
+// generated seeks land on the intended frame. Time literals:
+//   MM:SS, HH:MM:SS  - with an optional .m, .mm or .mmm fraction of a second
+//   HH:MM:SS:FF      - frame timecode, FF in [0, frame rate); the rate is a scan option
+//                      (ScanOptions::frameRate), DEFAULT_FRAME_RATE when the script sets none
+struct TimePosition {
+    static constexpr int64_t DEFAULT_FRAME_RATE = 30;
+    int64_t milliseconds = 0;
+
+    constexpr TimePosition() = default;
+    constexpr TimePosition(int64_t min, int64_t seg) : milliseconds((min * 60 + seg) * 1000) {}
+    static constexpr TimePosition fromMilliseconds(int64_t ms) {
+        TimePosition time;
+        time.milliseconds = ms;
+        return time;
+    }
+    // First millisecond of a frame (rounded up, so a seek there never lands on the previous frame)
+    static constexpr int64_t frameStart(int64_t frame, int64_t frameRate) {
+        return (frame * 1000 + frameRate - 1) / frameRate;
+    }
+    // Parse a time literal
+    explicit TimePosition(const std::string& timeStr, int64_t frameRate = DEFAULT_FRAME_RATE) {
+        if (!parse(timeStr, milliseconds, frameRate)) {
+            throw std::invalid_argument("Invalid time format: " + timeStr);
+        }
+    }
+    // Validates and decodes a time literal in a single pass, without allocating or throwing.
+    // A frame timecode is rejected when frameRate is not positive (rate unknown).
+    static bool parse(std::string_view text, int64_t& ms, int64_t frameRate = DEFAULT_FRAME_RATE) {
+        const char* p = text.data();
+        const char* end = p + text.size();
+        int fields[4] = {};
+        int count = 0;
+        while (true) {
+            if (count == 4 || p == end || *p < '0' || *p > '9') return false;
+            auto [next, error] = std::from_chars(p, end, fields[count++]);
+            if (error != std::errc()) return false;
+            p = next;
+            if (p == end || *p != ':') break;
+            p++;
+        }
+        if (count < 2) return false;
+        int64_t fraction = 0;
+        if (count < 4 && p != end && *p == '.') {
+            const char* digits = ++p;
+            while (p != end && p - digits < 3 && *p >= '0' && *p <= '9') fraction = fraction * 10 + (*p++ - '0');
+            if (p == digits) return false;
+            for (auto n = p - digits; n < 3; n++) fraction *= 10;
+        }
+        if (p != end) return false;
+        if (count == 4 && (frameRate <= 0 || fields[3] >= frameRate)) return false;
+
+        int64_t seconds = count == 2 ? int64_t(fields[0]) * 60 + fields[1] : (int64_t(fields[0]) * 60 + fields[1]) * 60 + fields[2];
+        ms = seconds * 1000 + fraction + (count == 4 ? frameStart(fields[3], frameRate) : 0);
+        return true;
+    }
+    // HH:MM:SS.mmm, which ffmpeg takes as a position
+    std::string toString() const {
+        char text[32];
+        std::snprintf(text, sizeof(text), "%02lld:%02lld:%02lld.%03lld", static_cast<long long>(milliseconds / 3600000),
+            static_cast<long long>(milliseconds / 60000 % 60), static_cast<long long>(milliseconds / 1000 % 60),
+            static_cast<long long>(milliseconds % 1000));
+        return text;
+    }
+    // Seconds with three decimals, for players that take a number of seconds
+    std::string toSecondsString() const {
+        char text[32];
+        std::snprintf(text, sizeof(text), "%lld.%03lld", static_cast<long long>(milliseconds / 1000),
+            static_cast<long long>(milliseconds % 1000));
+        return text;
+    }
+    // sum = a + b and product = a * n, false (and no result) when the milliseconds would not fit
+    // in int64_t. Times are never negative.
+    static constexpr bool add(const TimePosition& a, const TimePosition& b, TimePosition& sum) {
+        if (a.milliseconds > INT64_MAX - b.milliseconds) return false;
+        sum = fromMilliseconds(a.milliseconds + b.milliseconds);
+        return true;
+    }
+    static constexpr bool multiply(const TimePosition& a, int64_t n, TimePosition& product) {
+        if (n < 0 || (n > 0 && a.milliseconds > INT64_MAX / n)) return false;
+        product = fromMilliseconds(a.milliseconds * n);
+        return true;
+    }
+    constexpr TimePosition operator+(const TimePosition& other) const {
+        TimePosition sum;
+        if (!add(*this, other, sum)) throw std::overflow_error("Time out of range");
+        return sum;
+    }
+    constexpr TimePosition operator*(int64_t n) const {
+        if (n < 0) throw std::invalid_argument("Time cannot be negative");
+        TimePosition product;
+        if (!multiply(*this, n, product)) throw std::overflow_error("Time out of range");
+        return product;
+    }
+    constexpr bool operator==(const TimePosition& other) const {
+        return milliseconds == other.milliseconds;
+    }
+    constexpr bool operator!=(const TimePosition& other) const {
+        return milliseconds != other.milliseconds;
+    }
+};
+static_assert(TimePosition(1, 30) + TimePosition(0, 45) == TimePosition(2, 15), "time sum");
+static_assert(TimePosition(0, 10) * 3 == TimePosition(0, 30), "time product");
+
+//TOKEN SPECIFICATION
+/*
+The whole token set of the language. TokenType, TokenTypeLiteral, the keyword table, the
+character classes and the lexer DFA are all generated from it at compile time, so a new
+operator or reserved word is one line here.
+
+KIND(name)         - a token kind (TokenType keeps this order)
+SYMBOL(text, kind) - an operator; the longest one wins ("==" over "=")
+WORD(text, kind)   - a reserved word; any other letter/digit run starting with a letter is an ID.
+                     Each word has a kind of its own, so the parser tells them apart by kind.
+
+Integers, strings, times and comments have their own rules in the Lexer.
+*/
+#define VIDEO_TOKENS(KIND, SYMBOL, WORD) \
+    KIND(ID) KIND(ASSIGN_OP) KIND(INT) KIND(ADD_OP) KIND(MUL_OP) KIND(PRINT_KEY) KIND(OPEN_PAR) \
+    KIND(CLOSE_PAR) KIND(EOP) KIND(FRAME_KEY) KIND(CONCAT_KEY) KIND(AUDIO_KEY) KIND(PLAY_KEY) \
+    KIND(STRING) KIND(NUMBER) KIND(TIME) KIND(SEMICOLON) KIND(TO) KIND(LET) KIND(IF) KIND(THEN) \
+    KIND(EQUALS) KIND(END) \
+    SYMBOL("=", ASSIGN_OP) SYMBOL("==", EQUALS) SYMBOL("+", ADD_OP) SYMBOL("*", MUL_OP) \
+    SYMBOL("(", OPEN_PAR) SYMBOL(")", CLOSE_PAR) SYMBOL(";", SEMICOLON) SYMBOL("$", EOP) \
+    WORD("print", PRINT_KEY) WORD("let", LET) WORD("if", IF) WORD("then", THEN) WORD("to", TO) \
+    WORD("frame", FRAME_KEY) WORD("concat", CONCAT_KEY) WORD("audio", AUDIO_KEY) WORD("play", PLAY_KEY)
+
+#define VIDEO_TOKEN_SKIP(...)
+#define VIDEO_TOKEN_ENUM(name) name,
+#define VIDEO_TOKEN_NAME(name) #name,
+#define VIDEO_TOKEN_LEXEME(text, kind) { text, TokenType::kind },
+
+enum class TokenType {
+    VIDEO_TOKENS(VIDEO_TOKEN_ENUM, VIDEO_TOKEN_SKIP, VIDEO_TOKEN_SKIP)
+};
+
+std::string TokenTypeLiteral[] = {
+    VIDEO_TOKENS(VIDEO_TOKEN_NAME, VIDEO_TOKEN_SKIP, VIDEO_TOKEN_SKIP)
+};
+
+// A fixed lexeme (operator or reserved word) and its kind
+struct Keyword {
+    std::string_view text;
+    TokenType type;
+};
+constexpr Keyword SYMBOLS[] = {
+    VIDEO_TOKENS(VIDEO_TOKEN_SKIP, VIDEO_TOKEN_LEXEME, VIDEO_TOKEN_SKIP)
+};
+constexpr Keyword KEYWORDS[] = {
+    VIDEO_TOKENS(VIDEO_TOKEN_SKIP, VIDEO_TOKEN_SKIP, VIDEO_TOKEN_LEXEME)
+};
+
+//CHARACTER CLASSES
+// One table load per byte instead of the <cctype> calls, which depend on the locale and are
+// undefined for negative chars (UTF-8 bytes such as a BOM). Bytes that cannot start a token
+// (including every byte >= 0x80) are CHAR_INVALID.
+enum CharClass : uint8_t {
+    CHAR_SPACE = 1,
+    CHAR_ALPHA = 2,
+    CHAR_DIGIT = 4,
+    CHAR_QUOTE = 8,
+    CHAR_HASH = 16,
+    CHAR_INVALID = 32,
+    CHAR_ALNUM = CHAR_ALPHA | CHAR_DIGIT
+};
+constexpr std::array<uint8_t, 256> buildCharClasses() {
+    std::array<uint8_t, 256> table{};
+    for (int c = 0; c < 256; c++) table[c] = CHAR_INVALID;
+    for (const Keyword& symbol : SYMBOLS) table[static_cast<unsigned char>(symbol.text[0])] = 0;
+    for (int c = 'a'; c <= 'z'; c++) table[c] = CHAR_ALPHA;
+    for (int c = 'A'; c <= 'Z'; c++) table[c] = CHAR_ALPHA;
+    for (int c = '0'; c <= '9'; c++) table[c] = CHAR_DIGIT;
+    for (char c : { ' ', '\t', '\n', '\v', '\f', '\r' }) table[static_cast<unsigned char>(c)] = CHAR_SPACE;
+    table['"'] = CHAR_QUOTE;
+    table['#'] = CHAR_HASH;
+    return table;
+}
+constexpr std::array<uint8_t, 256> CHAR_CLASSES = buildCharClasses();
+constexpr uint8_t charClass(unsigned char c) {
+    return CHAR_CLASSES[c];
+}
+
+//LEXER DFA
+/*
+Dense transition table built at compile time from the token specification: DFA.next[state][byte]
+is the next state, or DFA_DEAD when the lexeme cannot go on. The Lexer runs it from DFA_START
+with one table load per byte and keeps the longest accepted prefix; DFA.accept[state] says what
+was matched. Every symbol and reserved word is a path of its own and any other letter/digit run
+falls back to the identifier state, so telling keywords from identifiers costs nothing extra.
+
+Spaces, comments and quoted literals stop the DFA after their first byte, the Lexer skips the
+rest with the vectorized kernels (ScanKernels.h).
+*/
+enum class Match : uint8_t {
+    NONE, FIXED, IDENT, INT, SPACE, COMMENT, QUOTE, INVALID
+};
+struct DfaAccept {
+    Match match = Match::NONE;
+    TokenType type = TokenType::ID;
+    std::string_view text;  // Of FIXED lexemes
+};
+constexpr uint8_t DFA_DEAD = 0, DFA_START = 1, DFA_IDENT = 2, DFA_INT = 3, DFA_SPACE = 4,
+    DFA_COMMENT = 5, DFA_QUOTE = 6, DFA_INVALID = 7, DFA_FIRST_PATH = 8;
+
+// One state per distinct prefix of the fixed lexemes, after the fixed states
+constexpr size_t countDfaStates() {
+    size_t count = DFA_FIRST_PATH;
+    auto seen = [](std::string_view prefix, const Keyword* lexemes, size_t n) {
+        for (size_t k = 0; k < n; k++) {
+            if (lexemes[k].text.substr(0, prefix.size()) == prefix) return true;
+        }
+        return false;
+    };
+    for (size_t k = 0; k < std::size(SYMBOLS); k++) {
+        for (size_t len = 1; len <= SYMBOLS[k].text.size(); len++) count += !seen(SYMBOLS[k].text.substr(0, len), SYMBOLS, k);
+    }
+    for (size_t k = 0; k < std::size(KEYWORDS); k++) {
+        for (size_t len = 1; len <= KEYWORDS[k].text.size(); len++) count += !seen(KEYWORDS[k].text.substr(0, len), KEYWORDS, k);
+    }
+    return count;
+}
+constexpr size_t DFA_STATES = countDfaStates();
+static_assert(DFA_STATES <= 256, "Too many DFA states for uint8_t");
+
+struct DfaTables {
+    uint8_t next[DFA_STATES][256] = {};
+    DfaAccept accept[DFA_STATES] = {};
+    size_t states = DFA_FIRST_PATH;
+
+    // Adds the path of a fixed lexeme. A new state starts as a copy of the one it replaces,
+    // so "fra" still goes on as an identifier.
+    constexpr void add(const Keyword& lexeme) {
+        uint8_t state = DFA_START;
+        for (char c : lexeme.text) {
+            uint8_t& slot = next[state][static_cast<unsigned char>(c)];
+            if (slot < DFA_FIRST_PATH) {
+                uint8_t path = static_cast<uint8_t>(states++);
+                for (int b = 0; b < 256; b++) next[path][b] = slot == DFA_DEAD ? DFA_DEAD : next[slot][b];
+                accept[path] = accept[slot];
+                slot = path;
+            }
+            state = slot;
+        }
+        accept[state] = { Match::FIXED, lexeme.type, lexeme.text };
+    }
+};
+constexpr DfaTables buildDfa() {
+    DfaTables dfa;
+    for (int c = 0; c < 256; c++) {
+        uint8_t cls = charClass(static_cast<unsigned char>(c));
+        uint8_t& start = dfa.next[DFA_START][c];
+        if (cls & CHAR_ALPHA) start = DFA_IDENT;
+        else if (cls & CHAR_DIGIT) start = DFA_INT;
+        else if (cls & CHAR_SPACE) start = DFA_SPACE;
+        else if (cls & CHAR_HASH) start = DFA_COMMENT;
+        else if (cls & CHAR_QUOTE) start = DFA_QUOTE;
+        else if (cls & CHAR_INVALID) start = DFA_INVALID;
+        if (cls & CHAR_ALNUM) dfa.next[DFA_IDENT][c] = DFA_IDENT;
+        if (cls & CHAR_DIGIT) dfa.next[DFA_INT][c] = DFA_INT;
+        if (cls & CHAR_INVALID) dfa.next[DFA_INVALID][c] = DFA_INVALID; // A run of them is one error
+    }
+    dfa.accept[DFA_IDENT].match = Match::IDENT;
+    dfa.accept[DFA_INT] = { Match::INT, TokenType::INT, "" };
+    dfa.accept[DFA_SPACE].match = Match::SPACE;
+    dfa.accept[DFA_COMMENT].match = Match::COMMENT;
+    dfa.accept[DFA_QUOTE].match = Match::QUOTE;
+    dfa.accept[DFA_INVALID].match = Match::INVALID;
+    for (const Keyword& symbol : SYMBOLS) dfa.add(symbol);
+    for (const Keyword& keyword : KEYWORDS) dfa.add(keyword);
+    return dfa;
+}
+constexpr DfaTables DFA = buildDfa();
+static_assert(DFA.states == DFA_STATES, "countDfaStates() and DfaTables::add() disagree");
+// value is a view into the source buffer given to tokenize()/Lexer (or into the Lexer's pool when
+// scanning a stream), so that buffer must outlive every Token (and every ASTNode) built from it.
+// Use str() when an owned copy is needed. offset is the byte offset of the token in the source,
+// LineIndex turns it into line:charPos when a message needs it.
+// number is decoded by the scanner, so the parser never parses the text again.
+struct Token {
+    TokenType type;
+    uint32_t offset;
+    std::string_view value;
+    int64_t number = 0; // INT value (INT64_MAX when it overflows), TIME in milliseconds
+    uint32_t symbol = 0; // SymbolTable ID of an ID or STRING (0 when the scanner had no table)
+    std::string str() const {
+        return std::string(value);
+    }
+};
+
+//STRUCT TO MARK ERRORS IN THE SCANNER
+struct ScannerError {
+    uint32_t offset;
+    std::string type;
+    std::string message;
+    uint32_t length = 1; // Bytes covered, more than 1 for a run of invalid characters (never across lines)
+};
+// Closes the error list when more than limit errors were found; offset is the first one left out
+ScannerError tooManyErrors(uint32_t offset, size_t count, size_t limit) {
+    return { offset, "TooManyErrors", std::to_string(count) + " more errors not reported (limit " + std::to_string(limit) + ")" };
+}
+
+//LINE INDEX
+// Offsets of the first byte of every line. An in-memory source is indexed on the first
+// locate() call; a streamed source is indexed chunk by chunk with append() as it is read.
+// locate() is a binary search, so the scanner never counts lines or columns itself.
+struct SourcePosition {
+    int line;
+    int charPos;
+};
+class LineIndex {
+    std::string_view source;
+    mutable std::vector<uint32_t> starts{ 0 };
+    mutable bool indexed = false;
+
+    void addLines(const char* data, size_t n, size_t offset) const {
+        for (size_t k = scan::findByte(data, n, '\n'); k < n; k += 1 + scan::findByte(data + k + 1, n - k - 1, '\n')) {
+            starts.push_back(static_cast<uint32_t>(offset + k + 1));
+        }
+    }
+
+public:
+    LineIndex() = default;
+    explicit LineIndex(std::string_view source) : source(source) {}
+
+    void append(const char* data, size_t n, size_t offset) {
+        addLines(data, n, offset);
+    }
+    SourcePosition locate(uint32_t offset) const {
+        if (!indexed) {
+            addLines(source.data(), std::min<size_t>(source.size(), UINT32_MAX), 0); // Offsets are 32-bit
+            indexed = true;
+        }
+        auto next = std::upper_bound(starts.begin(), starts.end(), offset);
+        size_t line = static_cast<size_t>(next - starts.begin());
+        return { static_cast<int>(line), static_cast<int>(offset - starts[line - 1] + 1) };
+    }
+};
+
+//KEEPS LEXEMES ALIVE WHEN THE LEXER READS FROM A STREAM
+// Stream input is read in chunks that get discarded once scanned, so identifier, number and
+// string lexemes are copied here. Blocks never move, so the views handed out stay valid.
+class LexemePool {
+    std::vector<std::unique_ptr<char[]>> blocks;
+    size_t used = 0;
+    size_t capacity = 0;
+    static constexpr size_t BLOCK_SIZE = 16 * 1024;
+
+public:
+    std::string_view store(std::string_view text) {
+        if (text.size() > capacity - used) {
+            capacity = std::max(BLOCK_SIZE, text.size());
+            blocks.emplace_back(new char[capacity]);
+            used = 0;
+        }
+        char* dest = blocks.back().get() + used;
+        std::copy(text.begin(), text.end(), dest);
+        used += text.size();
+        return std::string_view(dest, text.size());
+    }
+};
+
+//SYMBOL TABLE
+// Every distinct identifier and string literal gets a dense 32-bit ID, in order of first
+// appearance, so the parser compares and indexes by ID and only reads text to write output.
+// ID 0 (NO_SYMBOL) is the empty string. Texts are views with the same lifetime as Token::value,
+// except the ones stored with internCopy(), which the table keeps.
+class SymbolTable {
+    std::unordered_map<std::string_view, uint32_t> ids;
+    std::vector<std::string_view> texts;
+    LexemePool copies;
+
+public:
+    static constexpr uint32_t NO_SYMBOL = 0;
+
+    SymbolTable() {
+        intern("");
+    }
+    uint32_t intern(std::string_view text) {
+        auto [it, added] = ids.try_emplace(text, static_cast<uint32_t>(texts.size()));
+        if (added) texts.push_back(text);
+        return it->second;
+    }
+    // For text that does not outlive the call (a streamed window); each name is copied once
+    uint32_t internCopy(std::string_view text) {
+        uint32_t id = find(text);
+        return id != NO_SYMBOL || text.empty() ? id : intern(copies.store(text));
+    }
+    // NO_SYMBOL when text was never interned
+    uint32_t find(std::string_view text) const {
+        auto it = ids.find(text);
+        return it == ids.end() ? NO_SYMBOL : it->second;
+    }
+    std::string_view text(uint32_t id) const {
+        return texts[id];
+    }
+    size_t size() const {
+        return texts.size();
+    }
+};
+
+// Where the scanner is at a given byte: between tokens, inside a ## comment or inside a string.
+// (A # comment always ends at the newline, so it never has to be carried over.)
+enum class ScanState {
+    NORMAL, BLOCK_COMMENT, STRING
+};
+
+// Settings that change what a scan returns. Every tokenize*() entry point takes them, and
+// TokenCache keys its files on them.
+struct ScanOptions {
+    static constexpr size_t DEFAULT_ERROR_LIMIT = 1000;
+    // Errors past the limit are only counted, and summed up in one TooManyErrors at the end
+    size_t errorLimit = DEFAULT_ERROR_LIMIT;
+    int64_t frameRate = TimePosition::DEFAULT_FRAME_RATE; // Of HH:MM:SS:FF timecodes
+};
+
+//INCREMENTAL SCANNER
+// peekchar() - LookAhead(1), returns the next character without consuming it (EOF at the end).
+// getchar()  - returns the next character and moves the pointer.
+// gettoken() - scans and returns the next token; after the input ends it keeps returning an
+//              empty EOP token and done() becomes true.
+// An in-memory or memory-mapped source is scanned in place and token values are views into it.
+// A streamed source is read chunkSize bytes at a time, so only the current chunk and the lexeme
+// being scanned are held in memory.
+// Scripts are UTF-8: a byte order mark at the start is skipped, and strings and comments may
+// hold any UTF-8 text. A malformed sequence in them is one InvalidUtf8 error at its first byte.
+// Offsets are 32-bit: a script longer than MAX_SOURCE_SIZE is one SourceTooLarge error (an
+// in-memory one gives no tokens at all, a stream stops there).
+class Lexer {
+public:
+    static constexpr size_t DEFAULT_ERROR_LIMIT = ScanOptions::DEFAULT_ERROR_LIMIT;
+    static constexpr size_t MAX_SOURCE_SIZE = UINT32_MAX;
+
+private:
+    std::string_view buffer;      // Current window (the whole source in memory mode)
+    size_t i = 0;
+    SourceInput* in = nullptr;    // Set only while streaming
+    std::unique_ptr<SourceInput> ownedInput;
+    std::string window;           // Storage for the window in stream mode
+    size_t chunkSize = 0;
+    size_t lexemeStart = std::string::npos;
+    size_t base = 0;              // Source offset of buffer[0]
+    size_t limit = std::string::npos; // No token starts at or after this offset
+    LineIndex lineIndex;
+    bool finished = false;
+    std::vector<ScannerError>& errors;
+    LexemePool pool;
+    SymbolTable* symbols = nullptr;
+    size_t errorLimit = DEFAULT_ERROR_LIMIT;
+    int64_t frameRate = TimePosition::DEFAULT_FRAME_RATE;
+    size_t reported = 0;
+    size_t suppressed = 0;       // Errors past errorLimit, only counted
+    uint32_t firstSuppressed = 0;
+
+    bool ensure(size_t n) {
+        return i + n <= buffer.size() || refill(n);
+    }
+    // Drops the consumed part of the window (except an open lexeme) and reads more chunks
+    bool refill(size_t n) {
+        if (!in) return false;
+        size_t keep = std::min(i, lexemeStart);
+        window.erase(0, keep);
+        base += keep;
+        i -= keep;
+        if (lexemeStart != std::string::npos) lexemeStart -= keep;
+        while (i + n > window.size()) {
+            size_t old = window.size();
+            window.resize(old + chunkSize);
+            size_t got = in->read(&window[old], chunkSize);
+            bool tooLarge = got > MAX_SOURCE_SIZE - (base + old);
+            if (tooLarge) got = MAX_SOURCE_SIZE - (base + old);
+            window.resize(old + got);
+            lineIndex.append(window.data() + old, got, base + old);
+            if (tooLarge) {
+                // Nothing past the last addressable byte is read; the window no longer moves
+                rejectSource(static_cast<uint32_t>(MAX_SOURCE_SIZE));
+                in = nullptr;
+                break;
+            }
+            if (got == 0) break;
+        }
+        buffer = window;
+        return i + n <= buffer.size();
+    }
+
+    void beginLexeme() {
+        lexemeStart = i;
+    }
+    // The returned view is only valid until the next refill, use stable() to keep it
+    std::string_view endLexeme() {
+        std::string_view text = buffer.substr(lexemeStart, i - lexemeStart);
+        lexemeStart = std::string::npos;
+        return text;
+    }
+    std::string_view stable(std::string_view text) {
+        return in ? pool.store(text) : text;
+    }
+    uint32_t offset() const {
+        return static_cast<uint32_t>(base + i);
+    }
+    // No token starts after this, the script is too long for 32-bit offsets
+    void rejectSource(uint32_t at) {
+        errors.push_back({ at, "SourceTooLarge", "Script is larger than " + std::to_string(MAX_SOURCE_SIZE) + " bytes" });
+        limit = 0;
+    }
+    // True while errors are stored; past errorLimit they are only counted, without building a message
+    bool report(uint32_t offset) {
+        if (reported < errorLimit) {
+            reported++;
+            return true;
+        }
+        if (suppressed++ == 0) firstSuppressed = offset;
+        return false;
+    }
+
+    // ID/STRING token with its symbol. When streaming, the table keeps one copy of each name.
+    Token named(TokenType type, uint32_t start, std::string_view text) {
+        if (!symbols) return { type, start, stable(text) };
+        if (!in) return { type, start, text, 0, symbols->intern(text) };
+        uint32_t id = symbols->internCopy(text);
+        return { type, start, symbols->text(id), 0, id };
+    }
+
+    size_t available() const {
+        return buffer.size() - i;
+    }
+
+    // Runs the DFA from the current byte and consumes the longest lexeme it accepts (always at
+    // least one byte). The lexeme stays open, endLexeme() gives its text.
+    const DfaAccept& match() {
+        beginLexeme();
+        uint8_t state = DFA_START;
+        uint8_t last = DFA_START;
+        while (ensure(1)) {
+            const char* p = buffer.data();
+            size_t n = buffer.size();
+            while (i < n && (state = DFA.next[last][static_cast<unsigned char>(p[i])]) != DFA_DEAD) {
+                i++;
+                if (state == last) {
+                    // A self-loop (the rest of an identifier, number or invalid run) carries no state
+                    const uint8_t* row = DFA.next[state];
+                    while (i < n && row[static_cast<unsigned char>(p[i])] == state) i++;
+                }
+                last = state;
+            }
+            if (i < n) break;
+        }
+        if (DFA.accept[last].match != Match::NONE) return DFA.accept[last];
+        // Stopped inside a symbol that is only the prefix of a longer one: back up to the last accepted
+        size_t end = lexemeStart;
+        uint8_t accepted = DFA_DEAD;
+        state = DFA_START;
+        for (size_t k = lexemeStart; k < i; k++) {
+            state = DFA.next[state][static_cast<unsigned char>(buffer[k])];
+            if (DFA.accept[state].match != Match::NONE) {
+                accepted = state;
+                end = k + 1;
+            }
+        }
+        if (accepted == DFA_DEAD) {
+            // Not even the first byte is a lexeme: report it as an invalid character
+            i = lexemeStart + 1;
+            return DFA.accept[DFA_INVALID];
+        }
+        i = end;
+        return DFA.accept[accepted];
+    }
+    void skipWhitespace() {
+        while (ensure(1)) {
+            size_t n = scan::skipSpaces(buffer.data() + i, available());
+            bool more = n == available();
+            i += n;
+            if (!more) return;
+        }
+    }
+    // Skips up to (not including) the closing quote of a string body
+    void skipStringBody() {
+        while (ensure(1)) {
+            size_t n = scan::findByte(buffer.data() + i, available(), '"');
+            bool more = n == available();
+            i += n;
+            if (!more) return;
+        }
+    }
+
+    // A UTF-8 byte order mark at the very start is not part of the script
+    void skipBom() {
+        if (base + i == 0 && ensure(3) && buffer.compare(i, 3, "\xEF\xBB\xBF") == 0) i += 3;
+    }
+
+    // One InvalidUtf8 error for the sequence check stopped at, which ends just before end
+    void utf8Error(const scan::Utf8Check& check, uint32_t end, const char* what) {
+        uint32_t length = static_cast<uint32_t>(check.pending());
+        uint32_t start = end - length;
+        if (!report(start)) return;
+        const char* HEX = "0123456789ABCDEF";
+        std::string message = std::string(what) + " UTF-8 sequence:";
+        for (size_t k = 0; k < length; k++) {
+            unsigned char b = check.byte(k);
+            message += " 0x";
+            message += HEX[b >> 4];
+            message += HEX[b & 15];
+        }
+        errors.push_back({ start, "InvalidUtf8", message, length });
+    }
+    // Strings may hold any UTF-8 text; only the first malformed sequence is reported
+    void checkUtf8(std::string_view text, uint32_t offset) {
+        if (scan::asciiPrefix(text.data(), text.size()) == text.size()) return;
+        scan::Utf8Check check;
+        size_t k = check.feed(text.data(), text.size());
+        if (k < text.size()) utf8Error(check, static_cast<uint32_t>(offset + k + 1), "Invalid");
+        else if (!check.complete()) utf8Error(check, static_cast<uint32_t>(offset + k), "Truncated");
+    }
+    // Same for a comment, the next n bytes at a time; false once its error was reported
+    bool checkUtf8(scan::Utf8Check& check, size_t n) {
+        size_t k = check.feed(buffer.data() + i, n);
+        if (k == n) return true;
+        utf8Error(check, static_cast<uint32_t>(offset() + k + 1), "Invalid");
+        return false;
+    }
+
+    // Called past the first # of the comment at start
+    void skipComment(uint32_t start) {
+        scan::Utf8Check check;
+        bool checking = true;
+        if (peekchar() != '#') {
+            while (ensure(1)) {
+                size_t n = scan::findByte(buffer.data() + i, available(), '\n');
+                bool more = n == available();
+                if (checking) checking = checkUtf8(check, n);
+                i += n;
+                if (!more) break;
+            }
+            if (checking && !check.complete()) utf8Error(check, offset(), "Truncated");
+            return;
+        }
+        getchar();
+        while (ensure(2)) {
+            size_t n = scan::findPair(buffer.data() + i, available(), '#');
+            if (n + 1 < available()) {
+                if (checking && checkUtf8(check, n) && !check.complete()) utf8Error(check, offset() + n, "Truncated");
+                i += n + 2;
+                return;
+            }
+            // Keep the last byte, it may be the first # of a closing ## split across chunks
+            if (checking) checking = checkUtf8(check, available() - 1);
+            i += available() - 1;
+        }
+        // Unterminated: the byte kept last is comment text too
+        if (checking && ensure(1)) checking = checkUtf8(check, available());
+        if (checking && !check.complete()) utf8Error(check, static_cast<uint32_t>(offset() + available()), "Truncated");
+        while (getchar() != EOF) {}
+        if (report(start)) errors.push_back({ start, "UnterminatedComment", "Unterminated multi-line comment" });
+    }
+
+public:
+    Lexer(std::string_view source, std::vector<ScannerError>& errors)
+        : buffer(source), lineIndex(source), errors(errors) {
+        if (source.size() > MAX_SOURCE_SIZE) rejectSource(0);
+        else skipBom();
+    }
+    // Scans only the tokens that start in [begin, end) of source, entering it in the given state.
+    // A token or comment that starts before end is still scanned to its end.
+    Lexer(std::string_view source, size_t begin, size_t end, ScanState state, std::vector<ScannerError>& errors)
+        : buffer(source), i(begin), limit(end), lineIndex(source), errors(errors) {
+        if (source.size() > MAX_SOURCE_SIZE) {
+            i = 0;
+            rejectSource(0);
+        }
+        else if (state == ScanState::BLOCK_COMMENT) {
+            size_t n = scan::findPair(buffer.data() + i, available(), '#');
+            i += n < available() ? n + 2 : available();
+        }
+        else if (state == ScanState::STRING) {
+            size_t n = scan::findByte(buffer.data() + i, available(), '"');
+            i += n < available() ? n + 1 : available();
+        }
+        else {
+            skipBom();
+        }
+    }
+    // A mapped input is scanned in place, anything else is streamed
+    Lexer(SourceInput& input, std::vector<ScannerError>& errors, size_t chunkSize = SourceInput::CHUNK_SIZE)
+        : chunkSize(chunkSize), errors(errors) {
+        if (input.isMapped()) {
+            buffer = input.view();
+            lineIndex = LineIndex(buffer);
+            if (buffer.size() > MAX_SOURCE_SIZE) {
+                rejectSource(0);
+                return;
+            }
+        }
+        else {
+            in = &input;
+        }
+        skipBom();
+    }
+    Lexer(std::istream& input, std::vector<ScannerError>& errors, size_t chunkSize = SourceInput::CHUNK_SIZE)
+        : in(new SourceInput(input)), chunkSize(chunkSize), errors(errors) {
+        ownedInput.reset(in);
+        skipBom();
+    }
+
+    int peekchar() {
+        return ensure(1) ? static_cast<unsigned char>(buffer[i]) : EOF;
+    }
+    int getchar() {
+        return ensure(1) ? static_cast<unsigned char>(buffer[i++]) : EOF;
+    }
+    bool done() const {
+        return finished;
+    }
+    // Errors after the first limit are only counted, and summed up in one TooManyErrors at the end
+    void setErrorLimit(size_t limit) {
+        errorLimit = limit;
+    }
+    // Every error found so far, stored or not
+    size_t errorCount() const {
+        return reported + suppressed;
+    }
+    void setOptions(const ScanOptions& options) {
+        errorLimit = options.errorLimit;
+        frameRate = options.frameRate;
+    }
+    // Interns identifiers and strings into table from now on (it must outlive the tokens)
+    void setSymbols(SymbolTable& table) {
+        symbols = &table;
+    }
+    SymbolTable* symbolTable() const {
+        return symbols;
+    }
+    // Line starts seen so far (all of them once done())
+    const LineIndex& lines() const {
+        return lineIndex;
+    }
+
+    Token gettoken() {
+        while (true) {
+            int c = peekchar();
+            if (c == EOF || base + i >= limit) {
+                if (!finished && suppressed) errors.push_back(tooManyErrors(firstSuppressed, suppressed, errorLimit));
+                finished = true;
+                return { TokenType::EOP, offset(), "" };
+            }
+            // Most tokens are separated by spaces, the kernel skips them without starting the DFA
+            if (charClass(static_cast<unsigned char>(c)) & CHAR_SPACE) {
+                skipWhitespace();
+                continue;
+            }
+            uint32_t start = offset();
+            const DfaAccept& found = match();
+            std::string_view text = endLexeme();
+            switch (found.match) {
+            case Match::SPACE:
+                skipWhitespace();
+                continue;
+            case Match::COMMENT:
+                skipComment(start);
+                continue;
+            case Match::IDENT:
+                return named(TokenType::ID, start, text);
+            case Match::INT: {
+                int64_t value = 0;
+                if (std::from_chars(text.data(), text.data() + text.size(), value).ec != std::errc()) value = INT64_MAX;
+                return { TokenType::INT, start, stable(text), value };
+            }
+            case Match::FIXED:
+                // Symbol and keyword values point at the static specification
+                return { found.type, start, found.text };
+            case Match::QUOTE:
+                break;
+            default: {
+                // Invalid characters: a run of them is one error, with the whole run (a UTF-8
+                // character outside of a string is several bytes)
+                if (report(start)) {
+                    size_t characters = 0;
+                    for (char c : text) characters += (static_cast<unsigned char>(c) & 0xC0) != 0x80;
+                    std::string message = std::string(characters > 1 ? "Unexpected characters: " : "Unexpected character: ") + std::string(text);
+                    errors.push_back({ start, "InvalidCharacter", message, static_cast<uint32_t>(text.size()) });
+                }
+                continue;
+            }
+            }
+            // Strings and times
+            beginLexeme();
+            skipStringBody();
+            if (peekchar() == EOF) {
+                endLexeme();
+                if (report(start)) errors.push_back({ start, "UnclosedString", "Unclosed string literal" });
+                continue;
+            }
+            std::string_view str = endLexeme();
+            getchar();
+            if (str.find(':') != std::string_view::npos) {
+                int64_t ms = 0;
+                if (TimePosition::parse(str, ms, frameRate)) {
+                    return { TokenType::TIME, start, stable(str), ms };
+                }
+                if (report(start)) errors.push_back({ start, "InvalidTime", "Invalid time format: " + std::string(str) });
+            }
+            else if (str.empty()) {
+                if (report(start)) errors.push_back({ start, "EmptyString", "Empty string literal" });
+            }
+            else {
+                checkUtf8(str, start + 1);
+                return named(TokenType::STRING, start, str);
+            }
+        }
+    }
+};
+
+std::vector<Token> tokenize(Lexer& lexer) {
+    std::vector<Token> tokens;
+    do {
+        tokens.push_back(lexer.gettoken());
+    } while (!lexer.done());
+    return tokens;
+}
+// Scans the whole source at once. Token values are views into source (see Token).
+std::vector<Token> tokenize(const std::string& source, std::vector<ScannerError>& errors, const ScanOptions& options = {}) {
+    Lexer lexer(source, errors);
+    lexer.setOptions(options);
+    return tokenize(lexer);
+}
+// Same, interning every identifier and string into symbols (give the table to the Parser too)
+std::vector<Token> tokenize(const std::string& source, std::vector<ScannerError>& errors, SymbolTable& symbols,
+    const ScanOptions& options = {}) {
+    Lexer lexer(source, errors);
+    lexer.setOptions(options);
+    lexer.setSymbols(symbols);
+    return tokenize(lexer);
+}
+// Token values point into the mapped file or the lexer's pool, keep input alive with the tokens
+std::vector<Token> tokenize(SourceInput& input, std::vector<ScannerError>& errors, const ScanOptions& options = {}) {
+    Lexer lexer(input, errors);
+    lexer.setOptions(options);
+    return tokenize(lexer);
+}
+// With a table, streamed identifiers and strings are kept by symbols instead of the lexer
+std::vector<Token> tokenize(SourceInput& input, std::vector<ScannerError>& errors, SymbolTable& symbols,
+    const ScanOptions& options = {}) {
+    Lexer lexer(input, errors);
+    lexer.setOptions(options);
+    lexer.setSymbols(symbols);
+    return tokenize(lexer);
+}
+
+//COMPACT TOKEN STREAM
+// Structure of arrays: a 1-byte kind plus 4-byte offset and length of the lexeme per token
+// (9 bytes, a fraction of a Token; ScannerBenchmark prints both per token). Text is sliced from
+// source, which must stay alive. INT and TIME literals are decoded once into a side table
+// ordered by token index.
+struct TokenStream {
+    std::string_view source;
+    std::vector<uint8_t> kinds;
+    std::vector<uint32_t> offsets;
+    std::vector<uint32_t> lengths;
+    std::vector<uint32_t> literalTokens;
+    std::vector<int64_t> literalValues; // INT value, or TIME in milliseconds
+
+    size_t size() const {
+        return kinds.size();
+    }
+    TokenType kind(size_t i) const {
+        return static_cast<TokenType>(kinds[i]);
+    }
+    // Token value, without the quotes of STRING and TIME lexemes
+    std::string_view text(size_t i) const {
+        TokenType type = kind(i);
+        if (type == TokenType::STRING || type == TokenType::TIME) return source.substr(offsets[i] + 1, lengths[i] - 2);
+        return source.substr(offsets[i], lengths[i]);
+    }
+    Token token(size_t i) const {
+        const int64_t* number = literal(i);
+        return { kind(i), offsets[i], text(i), number ? *number : 0 };
+    }
+    // Same for a front-to-back read, without the search: literal is the literalValues slot of
+    // the next INT/TIME token (0 for token 0), moved past token i when it is one
+    Token token(size_t i, size_t& literal) const {
+        TokenType type = kind(i);
+        switch (type) {
+        case TokenType::INT:
+            return { type, offsets[i], source.substr(offsets[i], lengths[i]), literalValues[literal++] };
+        case TokenType::TIME:
+            return { type, offsets[i], source.substr(offsets[i] + 1, lengths[i] - 2), literalValues[literal++] };
+        case TokenType::STRING:
+            return { type, offsets[i], source.substr(offsets[i] + 1, lengths[i] - 2) };
+        default:
+            return { type, offsets[i], source.substr(offsets[i], lengths[i]) };
+        }
+    }
+    // Decoded INT/TIME value of token i, nullptr for other tokens
+    const int64_t* literal(size_t i) const {
+        auto it = std::lower_bound(literalTokens.begin(), literalTokens.end(), i);
+        if (it == literalTokens.end() || *it != i) return nullptr;
+        return &literalValues[it - literalTokens.begin()];
+    }
+
+    void push(const Token& token) {
+        uint32_t index = static_cast<uint32_t>(kinds.size());
+        uint32_t length = static_cast<uint32_t>(token.value.size());
+        kinds.push_back(static_cast<uint8_t>(token.type));
+        offsets.push_back(token.offset);
+        if (token.type == TokenType::INT) {
+            literalTokens.push_back(index);
+            literalValues.push_back(token.number);
+        }
+        else if (token.type == TokenType::TIME) {
+            literalTokens.push_back(index);
+            literalValues.push_back(token.number);
+            length += 2;
+        }
+        else if (token.type == TokenType::STRING) {
+            length += 2;
+        }
+        lengths.push_back(length);
+    }
+    size_t bytes() const {
+        return kinds.capacity() * sizeof(uint8_t) + offsets.capacity() * sizeof(uint32_t)
+            + lengths.capacity() * sizeof(uint32_t) + literalTokens.capacity() * sizeof(uint32_t)
+            + literalValues.capacity() * sizeof(int64_t);
+    }
+    void shrinkToFit() {
+        kinds.shrink_to_fit();
+        offsets.shrink_to_fit();
+        lengths.shrink_to_fit();
+        literalTokens.shrink_to_fit();
+        literalValues.shrink_to_fit();
+    }
+};
+
+// Scans an in-memory (or mapped) source into a TokenStream
+TokenStream tokenizeStream(std::string_view source, std::vector<ScannerError>& errors, const ScanOptions& options = {}) {
+    TokenStream stream;
+    stream.source = source;
+    Lexer lexer(source, errors);
+    lexer.setOptions(options);
+    do {
+        stream.push(lexer.gettoken());
+    } while (!lexer.done());
+    stream.shrinkToFit();
+    return stream;
+}
+// One line per error on stderr, at line:col (line:col-col for a run)
+void reportScanErrors(const std::vector<ScannerError>& errors, const LineIndex& lines) {
+    for (const auto& err : errors) {
+        SourcePosition pos = lines.locate(err.offset);
+        std::cerr << "ERROR SCAN - Line " << pos.line << ":" << pos.charPos;
+        if (err.length > 1) std::cerr << "-" << pos.charPos + err.length - 1;
+        std::cerr << ", type: " << err.type << " - " << err.message << "\n";
+    }
+}
+// Traces every token as it is scanned (DEBUG), then reports the errors collected by the lexer
+bool scanAndLog(Lexer& lexer, std::vector<ScannerError>& errors) {
+    Tracer& trace = tracer();
+    if (trace.enabled(TraceLevel::INFO)) trace.record(TraceLevel::INFO, "SCAN") << "Start scanningc";
+    if (trace.enabled(TraceLevel::DEBUG)) {
+        while (!lexer.done()) {
+            Token token = lexer.gettoken();
+            if (token.type == TokenType::EOP && token.value.empty()) continue;
+            SourcePosition pos = lexer.lines().locate(token.offset);
+            std::string_view name = TokenTypeLiteral[(int)token.type];
+            Tracer::Record record = trace.record(TraceLevel::DEBUG, "SCAN");
+            record << name << " [ " << token.value << " ] found at (" << pos.line << ":" << pos.charPos << ")";
+            record.field("token", name).field("value", token.value).field("line", pos.line).field("col", pos.charPos);
+        }
+    }
+    else {
+        while (!lexer.done()) lexer.gettoken();
+    }
+
+    if (trace.enabled(TraceLevel::INFO)) {
+        Tracer::Record record = trace.record(TraceLevel::INFO, "SCAN");
+        record << "Completed with " << errors.size() << " errors";
+        record.field("errors", static_cast<int64_t>(errors.size()));
+    }
+    trace.flush();
+    reportScanErrors(errors, lexer.lines());
+    return errors.empty();
+}
+bool scanAndLog(const std::string& source, const ScanOptions& options = {}) {
+    std::vector<ScannerError> errors;
+    Lexer lexer(source, errors);
+    lexer.setOptions(options);
+    return scanAndLog(lexer, errors);
+}
+bool scanAndLog(SourceInput& input, const ScanOptions& options = {}) {
+    std::vector<ScannerError> errors;
+    Lexer lexer(input, errors);
+    lexer.setOptions(options);
+    return scanAndLog(lexer, errors);
+}
+
+
+
@@ -0,0 +1,564 @@
+#include "Pipeline.h"
+#include "ParallelScanner.h"
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <random>
+
+//SCANNER BENCHMARK
+/*
+Build: g++ -std=c++17 -O2 -pthread ScannerBenchmark.cpp -o ScannerBenchmark  (or cl /O2 /std:c++17 /EHsc)
+Run:   ScannerBenchmark                  every section below
+       ScannerBenchmark <section> [options]
+
+scan     - generated script (see ScriptShape); MB/s and tokens/s of every scanner backend
+           and of scanAndLog(), cold (caches flushed before each run) and warm (best run
+           after a first untimed one). Options:
+             --statements N     statements in the script
+             --mix L,F,C,A,P,I  weights of let, frame, concat, audio, play and if
+             --comments X       comments per statement (every fourth one a ## block)
+             --string-length N  characters of the file names in string literals
+             --identifiers N    distinct variable names (fewer means more reuse)
+             --seed N           random seed of the generator
+             --repeats N        timed runs per measurement
+keywords - identifier-heavy script; compares the old chain of string comparisons
+           ("before") against the Lexer's DFA, which tells keywords from identifiers
+           while it matches them ("after", the same words scanned by a Lexer)
+stream   - mixed command script; memory per token and parse throughput of
+           std::vector<Token> against the structure-of-arrays TokenStream
+pipeline - large command script; scan-then-parse on one thread against the pipelined
+           compile (lexer thread + parser thread over an SpscRing). Only faster with
+           two free cores.
+utf8     - scan::Utf8Check over ASCII and accented text, against a plain memchr pass
+           over the same bytes (the memory bandwidth it should get close to)
+ast      - 100k-statement command script; parse time, heap allocations (every operator
+           new of the program is counted) and arena use of the tree, and the full compile
+           (parseAndExecute(), which also writes AST.py and the Python script, into a
+           temporary directory). Then single expressions, nested in parentheses and as
+           long chains, and if chains (parsed and compiled), at two sizes (the time should
+           double with the size)
+*/
+
+// Heap allocations so far, counted for the ast section
+std::atomic<size_t> heapAllocations{ 0 };
+
+void* operator new(size_t size) {
+    heapAllocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+// GCC takes the free() of a replaced operator delete for a mismatch with operator new
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+void operator delete(void* p, size_t) noexcept {
+    std::free(p);
+}
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+// Keyword classification as tokenize() used to do it, kept here as the baseline
+TokenType classifyChain(const std::string& word) {
+    if (word == "print") return TokenType::PRINT_KEY;
+    else if (word == "let") return TokenType::LET;
+    else if (word == "if") return TokenType::IF;
+    else if (word == "then") return TokenType::THEN;
+    else if (word == "to") return TokenType::TO;
+    else if (word == "frame") return TokenType::FRAME_KEY;
+    else if (word == "concat") return TokenType::CONCAT_KEY;
+    else if (word == "audio") return TokenType::AUDIO_KEY;
+    else if (word == "play") return TokenType::PLAY_KEY;
+    return TokenType::ID;
+}
+
+// Statements full of identifiers, many of them sharing a prefix or length with a keyword
+std::string identifierScript(size_t statements) {
+    const char* names[] = { "clip", "plays", "frames", "tone", "iffy", "letter", "audios", "intro",
+        "outro", "then2", "concatenated", "p", "t", "fr", "playlist", "start" };
+    std::string script;
+    for (size_t i = 0; i < statements; i++) {
+        const char* a = names[i % 16];
+        const char* b = names[(i * 7 + 3) % 16];
+        script += "let " + std::string(a) + std::to_string(i % 100) + " = " + b + " + " + a + ";\n";
+        if (i % 4 == 0) script += "if " + std::string(b) + " == " + a + " then play " + b + ";\n";
+    }
+    return script;
+}
+
+// Every statement kind of the language, with a few variables reused across statements
+std::string commandScript(size_t statements) {
+    std::string script;
+    for (size_t i = 0; i < statements; i++) {
+        std::string n = std::to_string(i);
+        switch (i % 6) {
+        case 0: script += "let start" + n + " = \"0:" + std::to_string(i % 60) + "\" + \"1:05\";\n"; break;
+        case 1: script += "frame \"video" + n + ".mp4\" " + std::to_string(i % 500) + " to \"frame" + n + ".bmp\";\n"; break;
+        case 2: script += "concat \"clip" + n + ".mp4\" \"clip" + std::to_string(i + 1) + ".mp4\" to \"out" + n + ".mp4\";\n"; break;
+        case 3: script += "audio \"video" + n + ".mp4\" \"00:10\" \"00:20\" to \"audio" + n + ".mp3\";\n"; break;
+        case 4: script += "play \"out" + n + ".mp4\" \"0:01\" \"0:09\";\n"; break;
+        case 5: script += "if \"0:10\" == \"0:10\" then play \"video" + n + ".mp4\";\n"; break;
+        }
+    }
+    return script;
+}
+
+// Shape of a generated script
+struct ScriptShape {
+    size_t statements = 500000;
+    unsigned mix[6] = { 3, 1, 1, 1, 2, 1 }; // let, frame, concat, audio, play, if
+    double comments = 0.25;
+    size_t stringLength = 12;
+    size_t identifiers = 100;
+    unsigned seed = 1;
+};
+
+// Valid script of the given shape; the same shape always gives the same text
+std::string generateScript(const ScriptShape& shape) {
+    std::mt19937 random(shape.seed);
+    auto pick = [&random](size_t n) { return static_cast<size_t>(random() % n); };
+    auto name = [&](std::string& out) {
+        out += "var";
+        out += std::to_string(pick(std::max<size_t>(shape.identifiers, 1)));
+    };
+    auto file = [&](std::string& out, const char* extension) {
+        out += '"';
+        for (size_t k = 0; k < shape.stringLength; k++) out += static_cast<char>('a' + pick(26));
+        out += extension;
+        out += '"';
+    };
+    auto time = [&](std::string& out) {
+        out += "\"" + std::to_string(pick(60)) + ":" + std::to_string(10 + pick(50)) + "\"";
+    };
+    unsigned total = 0;
+    for (unsigned weight : shape.mix) total += weight;
+
+    std::string script;
+    double comments = 0;
+    for (size_t i = 0; i < shape.statements; i++) {
+        for (comments += shape.comments; comments >= 1; comments--) {
+            if (random() % 4 == 0) script += "## generated block comment\n   about the next statement ##\n";
+            else script += "# comment line describing what the next statement does\n";
+        }
+        unsigned roll = total ? static_cast<unsigned>(random() % total) : 0;
+        int kind = 0;
+        while (kind < 5 && roll >= shape.mix[kind]) roll -= shape.mix[kind++];
+        switch (kind) {
+        case 0:
+            script += "let ";
+            name(script);
+            script += " = ";
+            if (pick(2)) {
+                time(script);
+                script += " + ";
+                time(script);
+            }
+            else {
+                name(script);
+                script += " * " + std::to_string(pick(1000));
+            }
+            break;
+        case 1:
+            script += "frame ";
+            file(script, ".mp4");
+            script += " " + std::to_string(pick(5000)) + " to ";
+            file(script, ".bmp");
+            break;
+        case 2:
+            script += "concat ";
+            file(script, ".mp4");
+            script += " ";
+            file(script, ".mp4");
+            script += " to ";
+            file(script, ".mp4");
+            break;
+        case 3:
+            script += "audio ";
+            file(script, ".mp4");
+            script += " ";
+            time(script);
+            script += " ";
+            time(script);
+            script += " to ";
+            file(script, ".mp3");
+            break;
+        case 4:
+            script += "play ";
+            file(script, ".mp4");
+            if (pick(2)) {
+                script += " ";
+                time(script);
+                script += " ";
+                time(script);
+            }
+            break;
+        default:
+            script += "if ";
+            name(script);
+            script += " == ";
+            name(script);
+            script += " then play ";
+            file(script, ".mp4");
+            break;
+        }
+        script += ";\n";
+    }
+    return script;
+}
+
+template <typename F>
+double millis(int repeats, F&& body) {
+    auto start = std::chrono::steady_clock::now();
+    for (int r = 0; r < repeats; r++) body();
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count() / repeats;
+}
+
+void benchmarkKeywords() {
+    std::string script = identifierScript(200000);
+    std::vector<ScannerError> errors;
+    std::vector<Token> tokens = tokenize(script, errors);
+    std::vector<std::string_view> words;
+    std::string wordText; // The same words, one space apart, for the Lexer
+    for (const Token& token : tokens) {
+        TokenType type = token.type;
+        if (type == TokenType::ID || type == TokenType::LET || type == TokenType::IF || type == TokenType::THEN ||
+            type == TokenType::FRAME_KEY || type == TokenType::CONCAT_KEY || type == TokenType::AUDIO_KEY ||
+            type == TokenType::PLAY_KEY) {
+            words.push_back(token.value);
+            wordText += token.value;
+            wordText += ' ';
+        }
+    }
+
+    size_t checksum = 0;
+    double before = millis(10, [&] {
+        for (std::string_view word : words) {
+            std::string owned(word); // tokenize() used to build each word as a std::string
+            checksum += static_cast<size_t>(classifyChain(owned));
+        }
+    });
+    double after = millis(10, [&] {
+        std::vector<ScannerError> wordErrors;
+        Lexer lexer(wordText, wordErrors);
+        while (!lexer.done()) checksum += static_cast<size_t>(lexer.gettoken().type);
+    });
+    double scan = millis(5, [&] {
+        std::vector<ScannerError> scanErrors;
+        checksum += tokenize(script, scanErrors).size();
+    });
+
+    std::cout << "keywords: " << words.size() << " identifiers/keywords, " << script.size() / 1024 << " KiB\n";
+    std::cout << "  before (string chain) " << before << " ms\n";
+    std::cout << "  after  (Lexer DFA)    " << after << " ms\n";
+    std::cout << "  tokenize() total      " << scan << " ms  (checksum " << checksum % 1000 << ")\n";
+}
+
+void benchmarkTokenStream() {
+    std::string script = commandScript(300000);
+    std::vector<ScannerError> errors;
+    std::vector<Token> tokens = tokenize(script, errors);
+    TokenStream stream = tokenizeStream(script, errors);
+
+    double vectorBytes = static_cast<double>(tokens.capacity() * sizeof(Token)) / tokens.size();
+    double streamBytes = static_cast<double>(stream.bytes()) / stream.size();
+    size_t statements = 0;
+    double parseVector = millis(3, [&] {
+        Parser parser(tokens, script);
+        statements = parser.parse().as<ProgramNode>().statements.size();
+    });
+    double parseStream = millis(3, [&] {
+        Parser parser(stream);
+        statements = parser.parse().as<ProgramNode>().statements.size();
+    });
+    double mb = script.size() / (1024.0 * 1024.0);
+
+    std::cout << "stream: " << tokens.size() << " tokens, " << statements << " statements, " << mb << " MiB\n";
+    std::cout << "  std::vector<Token> " << vectorBytes << " bytes/token, parse " << parseVector << " ms ("
+        << mb / parseVector * 1000 << " MiB/s)\n";
+    std::cout << "  TokenStream        " << streamBytes << " bytes/token, parse " << parseStream << " ms ("
+        << mb / parseStream * 1000 << " MiB/s)\n";
+}
+
+void benchmarkPipeline() {
+    std::string script = commandScript(1000000);
+    double mb = script.size() / (1024.0 * 1024.0);
+    size_t statements = 0;
+    size_t errorCount = 0;
+
+    double sequential = millis(3, [&] {
+        std::vector<ScannerError> errors;
+        std::vector<Token> tokens = tokenize(script, errors);
+        Parser parser(tokens, script);
+        statements = parser.parse().as<ProgramNode>().statements.size();
+        errorCount = errors.size() + parser.getErrors().size();
+    });
+    double pulled = millis(3, [&] {
+        std::vector<ScannerError> errors;
+        Lexer lexer(script, errors);
+        Parser parser(lexer);
+        statements = parser.parse().as<ProgramNode>().statements.size();
+    });
+    std::cout << "pipeline: " << statements << " statements, " << mb << " MiB, "
+        << std::thread::hardware_concurrency() << " hardware threads\n";
+    std::cout << "  sequential (tokenize, then parse) " << sequential << " ms (" << mb / sequential * 1000 << " MiB/s)\n";
+    std::cout << "  sequential (parser pulls lexer)   " << pulled << " ms (" << mb / pulled * 1000 << " MiB/s)\n";
+
+    for (size_t capacity : { 64, 1024, 4096, 65536 }) {
+        double time = millis(3, [&] {
+            std::vector<ScannerError> errors;
+            size_t parseErrors = 0;
+            statements = pipelined(script, errors, [&parseErrors](Parser& parser) {
+                size_t count = parser.parse().as<ProgramNode>().statements.size();
+                parseErrors = parser.getErrors().size();
+                return count;
+            }, capacity);
+            if (errors.size() + parseErrors != errorCount) std::cout << "  error count mismatch\n";
+        });
+        std::cout << "  pipelined (ring of " << capacity << " tokens)  " << time << " ms (" << mb / time * 1000 << " MiB/s)\n";
+    }
+}
+
+void benchmarkUtf8() {
+    std::string ascii = commandScript(1000000);
+    std::string accented;
+    for (size_t k = 0; k < ascii.size(); k += 64) {
+        accented.append(ascii, k, 60);
+        accented += "\xC3\xA9\xE2\x82\xAC"; // "é€"
+    }
+    for (const std::string* text : { &ascii, &accented }) {
+        double mb = text->size() / (1024.0 * 1024.0);
+        const char* volatile data = text->data(); // Read again on every pass, so no pass is skipped
+        size_t found = 0;
+        double memchrTime = millis(10, [&] {
+            found += std::memchr(data, '\x01', text->size()) == nullptr;
+        });
+        double checkTime = millis(10, [&] {
+            scan::Utf8Check check;
+            found += check.feed(data, text->size()) == text->size();
+        });
+        std::cout << "utf8: " << (text == &ascii ? "ascii" : "accented") << " " << mb << " MiB, " << found << " passes\n";
+        std::cout << "  memchr     " << memchrTime << " ms (" << mb / memchrTime * 1000 << " MiB/s)\n";
+        std::cout << "  Utf8Check  " << checkTime << " ms (" << mb / checkTime * 1000 << " MiB/s)\n";
+    }
+}
+
+// Average time of parseAndExecute() over tokens, run in a temporary directory so the files it
+// writes don't replace the ones of the working directory
+double compileMillis(int repeats, const std::vector<Token>& tokens, std::string_view source) {
+    namespace fs = std::filesystem;
+    fs::path home = fs::current_path();
+    fs::path scratch = fs::temp_directory_path() / "video-compiler-benchmark";
+    fs::create_directories(scratch);
+    fs::current_path(scratch);
+    std::streambuf* console = std::cout.rdbuf(nullptr); // Its "Generated ..." line
+    double time = millis(repeats, [&] {
+        Parser parser(tokens, source);
+        parser.parseAndExecute();
+    });
+    std::cout.rdbuf(console);
+    std::cout.clear();
+    fs::current_path(home);
+    fs::remove_all(scratch);
+    return time;
+}
+
+void benchmarkAst() {
+    std::string script = commandScript(100000);
+    std::vector<ScannerError> errors;
+    std::vector<Token> tokens = tokenize(script, errors);
+
+    size_t statements = 0;
+    size_t allocations = 0;
+    size_t nodes = 0;
+    size_t used = 0;
+    size_t reserved = 0;
+    size_t blocks = 0;
+    double parse = millis(5, [&] {
+        size_t before = heapAllocations.load(std::memory_order_relaxed);
+        {
+            Parser parser(tokens, script);
+            statements = parser.parse().as<ProgramNode>().statements.size();
+            const Arena& arena = parser.memory();
+            nodes = arena.allocations();
+            used = arena.bytesUsed();
+            reserved = arena.bytesReserved();
+            blocks = arena.blockCount();
+        }
+        allocations = heapAllocations.load(std::memory_order_relaxed) - before;
+    });
+    std::cout << "ast: " << statements << " statements, " << tokens.size() << " tokens\n";
+    std::cout << "  parse + free        " << parse << " ms\n";
+    std::cout << "  heap allocations    " << allocations << " (" << static_cast<double>(allocations) / statements << " per statement)\n";
+    std::cout << "  arena               " << nodes << " allocations, " << used / 1024 << " KiB used, "
+        << reserved / 1024 << " KiB in " << blocks << " blocks\n";
+    std::cout << "  compile             " << compileMillis(5, tokens, script) << " ms\n";
+
+    for (size_t depth : { 1000, 2000 }) {
+        std::string nested = "let t = ";
+        for (size_t k = 0; k < depth; k++) nested += "\"0:01\" + (";
+        nested += "\"0:01\"" + std::string(depth, ')') + ";";
+        std::vector<Token> nestedTokens = tokenize(nested, errors);
+        double time = millis(5, [&] {
+            Parser parser(nestedTokens, nested);
+            parser.parse();
+        });
+        std::cout << "  nested " << depth << " deep  " << time << " ms\n";
+    }
+    // if ... then if ...: the parse stack grows on the heap, not on the call stack, and the
+    // writers loop down the chain
+    for (size_t depth : { 10000, 100000 }) {
+        std::string chained;
+        for (size_t k = 0; k < depth; k++) chained += "if 1 == 1 then ";
+        chained += "play \"v.mp4\";";
+        std::vector<Token> chainedTokens = tokenize(chained, errors);
+        double time = millis(5, [&] {
+            Parser parser(chainedTokens, chained);
+            parser.parse();
+        });
+        std::cout << "  if chain " << depth << " deep  " << time << " ms, compiled "
+            << compileMillis(5, chainedTokens, chained) << " ms\n";
+    }
+    for (size_t terms : { 100000, 200000 }) {
+        std::string chain = "let t = \"0:01\"";
+        for (size_t k = 1; k < terms; k++) chain += k % 2 ? " * 1" : " + \"0:01\"";
+        chain += ";";
+        std::vector<Token> chainTokens = tokenize(chain, errors);
+        double time = millis(5, [&] {
+            Parser parser(chainTokens, chain);
+            parser.parse();
+        });
+        std::cout << "  chain of " << terms << " terms  " << time << " ms\n";
+    }
+}
+
+// Writes a buffer bigger than the last-level cache, so the next run finds nothing of the script cached
+void evictCaches() {
+    static std::vector<char> junk(128 * 1024 * 1024);
+    for (size_t k = 0; k < junk.size(); k += 64) junk[k]++;
+}
+
+struct Throughput {
+    double cold; // ms
+    double warm; // ms
+};
+template <typename F>
+Throughput measure(int repeats, F&& body) {
+    Throughput best{ 1e300, 1e300 };
+    for (int r = 0; r < repeats; r++) {
+        evictCaches();
+        best.cold = std::min(best.cold, millis(1, body));
+    }
+    body();
+    for (int r = 0; r < repeats; r++) best.warm = std::min(best.warm, millis(1, body));
+    return best;
+}
+
+void benchmarkScanners(const ScriptShape& shape, int repeats) {
+    std::string script = generateScript(shape);
+    std::vector<ScannerError> errors;
+    size_t tokens = tokenize(script, errors).size();
+    double mb = script.size() / 1e6;
+    std::cout << "scan: " << shape.statements << " statements, " << mb << " MB, " << tokens << " tokens, "
+        << errors.size() << " errors, " << repeats << " runs\n";
+    std::cout << "  backend                  cold MB/s  cold Mtok/s   warm MB/s  warm Mtok/s\n";
+    auto report = [&](const char* backend, Throughput time) {
+        char line[128];
+        std::snprintf(line, sizeof(line), "  %-22s %11.1f %12.2f %11.1f %12.2f\n", backend,
+            mb / time.cold * 1000, tokens / 1e6 / time.cold * 1000, mb / time.warm * 1000, tokens / 1e6 / time.warm * 1000);
+        std::cout << line;
+    };
+
+    size_t sink = 0;
+    report("tokenize()", measure(repeats, [&] {
+        std::vector<ScannerError> scanErrors;
+        sink += tokenize(script, scanErrors).size();
+    }));
+    report("tokenize() + symbols", measure(repeats, [&] {
+        std::vector<ScannerError> scanErrors;
+        SymbolTable symbols;
+        sink += tokenize(script, scanErrors, symbols).size();
+    }));
+    report("tokenizeStream()", measure(repeats, [&] {
+        std::vector<ScannerError> scanErrors;
+        sink += tokenizeStream(script, scanErrors).size();
+    }));
+    report("tokenizeParallel()", measure(repeats, [&] {
+        std::vector<ScannerError> scanErrors;
+        sink += tokenizeParallel(script, scanErrors).size();
+    }));
+    report("Lexer on std::istream", measure(repeats, [&] {
+        std::vector<ScannerError> scanErrors;
+        std::istringstream input(script);
+        Lexer lexer(input, scanErrors);
+        sink += tokenize(lexer).size();
+    }));
+
+    // scanAndLog() writes its trace to the null device, so only the formatting is measured
+#ifdef _WIN32
+    FILE* null = std::fopen("NUL", "w");
+#else
+    FILE* null = std::fopen("/dev/null", "w");
+#endif
+    Tracer& trace = tracer();
+    trace.setOutput(null ? null : stdout);
+    trace.setLevel(TraceLevel::INFO);
+    report("scanAndLog() (INFO)", measure(repeats, [&] { sink += scanAndLog(script); }));
+    if (Tracer::compiled(TraceLevel::DEBUG)) {
+        trace.setLevel(TraceLevel::DEBUG);
+        report("scanAndLog() (DEBUG)", measure(repeats, [&] { sink += scanAndLog(script); }));
+    }
+    trace.setOutput(stdout);
+    if (null) std::fclose(null);
+    std::cout << "  (checksum " << sink % 1000 << ")\n";
+}
+
+int main(int argc, char** argv) {
+    std::string section = argc > 1 ? argv[1] : "";
+    ScriptShape shape;
+    int repeats = 3;
+    for (int k = 2; k < argc; k += 2) {
+        std::string option = argv[k];
+        if (k + 1 == argc) {
+            std::cerr << "Missing value for option " << option << "\n";
+            return 1;
+        }
+        const char* value = argv[k + 1];
+        if (option == "--statements") shape.statements = std::strtoull(value, nullptr, 10);
+        else if (option == "--comments") shape.comments = std::atof(value);
+        else if (option == "--string-length") shape.stringLength = std::strtoull(value, nullptr, 10);
+        else if (option == "--identifiers") shape.identifiers = std::strtoull(value, nullptr, 10);
+        else if (option == "--seed") shape.seed = static_cast<unsigned>(std::strtoul(value, nullptr, 10));
+        else if (option == "--repeats") repeats = std::max(1, std::atoi(value));
+        else if (option == "--mix") {
+            std::stringstream weights(value);
+            std::string weight;
+            for (unsigned& slot : shape.mix) {
+                slot = std::getline(weights, weight, ',') ? static_cast<unsigned>(std::strtoul(weight.c_str(), nullptr, 10)) : 0;
+            }
+        }
+        else {
+            std::cerr << "Unknown option " << option << "\n";
+            return 1;
+        }
+    }
+
+    bool all = section.empty();
+    if (!all && section != "scan" && section != "keywords" && section != "stream" && section != "pipeline" && section != "utf8" && section != "ast") {
+        std::cerr << "Unknown section " << section << " (scan, keywords, stream, pipeline, utf8, ast)\n";
+        return 1;
+    }
+    if (all || section == "scan") benchmarkScanners(shape, repeats);
+    if (all || section == "keywords") benchmarkKeywords();
+    if (all || section == "stream") benchmarkTokenStream();
+    if (all || section == "pipeline") benchmarkPipeline();
+    if (all || section == "utf8") benchmarkUtf8();
+    if (all || section == "ast") benchmarkAst();
+    return 0;
+}
@@ -0,0 +1,167 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <istream>
+#include <cerrno>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+//SCRIPT INPUT
+/*
+Regular files are memory-mapped and scanned in place, so the script is never copied.
+Pipes, stdin, std::istreams and anything that cannot be mapped are streamed with read()
+in chunks of CHUNK_SIZE bytes.
+
+open(path)  - opens a script, "-" means stdin
+isMapped()  - true when view() holds the whole script
+view()      - the mapped bytes (token values point into them, so keep the SourceInput
+              alive as long as the tokens/AST)
+read()      - next chunk of a streamed input, 0 at the end
+*/
+class SourceInput {
+public:
+    static constexpr size_t CHUNK_SIZE = 64 * 1024;
+
+private:
+    std::string_view mapped;
+    std::istream* stream = nullptr;
+    bool ended = false;
+#ifdef _WIN32
+    HANDLE file = INVALID_HANDLE_VALUE;
+    HANDLE mapping = nullptr;
+    bool ownsFile = false;
+#else
+    int fd = -1;
+    bool ownsFd = false;
+#endif
+
+    // Maps the handle if it is a non-empty regular file, otherwise leaves it for read()
+    void tryMap() {
+#ifdef _WIN32
+        LARGE_INTEGER size;
+        if (GetFileType(file) != FILE_TYPE_DISK || !GetFileSizeEx(file, &size) || size.QuadPart == 0) return;
+        mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (!mapping) return;
+        void* data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        if (!data) {
+            CloseHandle(mapping);
+            mapping = nullptr;
+            return;
+        }
+        mapped = std::string_view(static_cast<const char*>(data), static_cast<size_t>(size.QuadPart));
+#else
+        struct stat info;
+        if (fstat(fd, &info) != 0 || !S_ISREG(info.st_mode) || info.st_size == 0) return;
+        void* data = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED) return;
+        madvise(data, static_cast<size_t>(info.st_size), MADV_SEQUENTIAL);
+        mapped = std::string_view(static_cast<const char*>(data), static_cast<size_t>(info.st_size));
+#endif
+    }
+
+    void close() {
+#ifdef _WIN32
+        if (!mapped.empty()) UnmapViewOfFile(mapped.data());
+        if (mapping) CloseHandle(mapping);
+        if (ownsFile && file != INVALID_HANDLE_VALUE) CloseHandle(file);
+        file = INVALID_HANDLE_VALUE;
+        mapping = nullptr;
+        ownsFile = false;
+#else
+        if (!mapped.empty()) munmap(const_cast<char*>(mapped.data()), mapped.size());
+        if (ownsFd && fd >= 0) ::close(fd);
+        fd = -1;
+        ownsFd = false;
+#endif
+        mapped = {};
+        stream = nullptr;
+        ended = false;
+    }
+
+public:
+    SourceInput() = default;
+    // Streams from an already open std::istream (which must outlive this object)
+    explicit SourceInput(std::istream& in) : stream(&in) {}
+    ~SourceInput() {
+        close();
+    }
+    SourceInput(const SourceInput&) = delete;
+    SourceInput& operator=(const SourceInput&) = delete;
+
+    bool open(const std::string& path) {
+        close();
+        if (path == "-") return openStdin();
+#ifdef _WIN32
+        file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+            FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (file == INVALID_HANDLE_VALUE) return false;
+        ownsFile = true;
+#else
+        fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) return false;
+        ownsFd = true;
+#endif
+        tryMap();
+        return true;
+    }
+    // stdin is mapped as well when it is redirected from a regular file
+    bool openStdin() {
+        close();
+#ifdef _WIN32
+        file = GetStdHandle(STD_INPUT_HANDLE);
+        if (file == INVALID_HANDLE_VALUE || file == nullptr) return false;
+#else
+        fd = STDIN_FILENO;
+#endif
+        tryMap();
+        return true;
+    }
+
+    bool isMapped() const {
+        return !mapped.empty();
+    }
+    std::string_view view() const {
+        return mapped;
+    }
+
+    size_t read(char* dest, size_t n) {
+        if (isMapped() || ended) return 0;
+        if (stream) {
+            stream->read(dest, static_cast<std::streamsize>(n));
+            size_t got = static_cast<size_t>(stream->gcount());
+            if (got == 0) ended = true;
+            return got;
+        }
+#ifdef _WIN32
+        DWORD got = 0;
+        if (file == INVALID_HANDLE_VALUE || !ReadFile(file, dest, static_cast<DWORD>(n), &got, nullptr) || got == 0) {
+            ended = true;
+            return 0;
+        }
+        return got;
+#else
+        while (fd >= 0) {
+            ssize_t got = ::read(fd, dest, n);
+            if (got > 0) return static_cast<size_t>(got);
+            if (got < 0 && errno == EINTR) continue;
+            break;
+        }
+        ended = true;
+        return 0;
+#endif
+    }
+};
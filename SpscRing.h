@@ -0,0 +1,99 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <thread>
+
+//SINGLE-PRODUCER/SINGLE-CONSUMER RING
+/*
+Bounded lock-free queue between exactly two threads, used to hand tokens from the lexer
+thread to the parser thread (see Pipeline.h).
+
+push()   - producer; waits while the ring is full (backpressure on a lexer that runs ahead)
+close()  - producer; no more items, pop() returns false once the ring is drained
+pop()    - consumer; waits while the ring is empty and not closed
+cancel() - consumer; stops reading early, a waiting or later push() returns false
+
+head and tail only grow (slot = index & mask). Each side keeps a copy of the other side's
+index and reloads it only when the ring looks full/empty, so most calls touch one cache line.
+*/
+template <typename T>
+class SpscRing {
+    static constexpr size_t LINE = 64;
+
+    std::unique_ptr<T[]> slots;
+    size_t mask;
+    alignas(LINE) std::atomic<size_t> head{ 0 }; // Next slot to read
+    size_t cachedTail = 0;                        // Consumer's view of tail
+    alignas(LINE) std::atomic<size_t> tail{ 0 }; // Next slot to write
+    size_t cachedHead = 0;                        // Producer's view of head
+    alignas(LINE) std::atomic<bool> closed{ false };
+    std::atomic<bool> cancelled{ false };
+
+    // Spins briefly, then gives the CPU to the other side, then sleeps longer and longer (up to
+    // about a millisecond), so a side that waits for long does not keep a core busy
+    static void pause(unsigned& spins) {
+        if (++spins <= 64) return;
+        if (spins <= 128) std::this_thread::yield();
+        else std::this_thread::sleep_for(std::chrono::microseconds(1u << std::min(spins - 129, 10u)));
+    }
+
+public:
+    // capacity is rounded up to a power of two
+    explicit SpscRing(size_t capacity) {
+        size_t size = 2;
+        while (size < capacity) size *= 2;
+        slots.reset(new T[size]);
+        mask = size - 1;
+    }
+    SpscRing(const SpscRing&) = delete;
+    SpscRing& operator=(const SpscRing&) = delete;
+
+    bool tryPush(const T& item) {
+        size_t t = tail.load(std::memory_order_relaxed);
+        if (t - cachedHead > mask) {
+            cachedHead = head.load(std::memory_order_acquire);
+            if (t - cachedHead > mask) return false;
+        }
+        slots[t & mask] = item;
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+    bool push(const T& item) {
+        unsigned spins = 0;
+        while (!tryPush(item)) {
+            if (cancelled.load(std::memory_order_acquire)) return false;
+            pause(spins);
+        }
+        return true;
+    }
+    void close() {
+        closed.store(true, std::memory_order_release);
+    }
+
+    bool tryPop(T& item) {
+        size_t h = head.load(std::memory_order_relaxed);
+        if (h == cachedTail) {
+            cachedTail = tail.load(std::memory_order_acquire);
+            if (h == cachedTail) return false;
+        }
+        item = slots[h & mask];
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+    bool pop(T& item) {
+        unsigned spins = 0;
+        while (!tryPop(item)) {
+            // Items pushed before close() are visible once closed is
+            if (closed.load(std::memory_order_acquire)) return tryPop(item);
+            pause(spins);
+        }
+        return true;
+    }
+    void cancel() {
+        cancelled.store(true, std::memory_order_release);
+    }
+};
@@ -0,0 +1,213 @@
+#pragma once
+
+#include "Scanner.h"
+#include <cstring>
+#include <filesystem>
+
+//TOKEN CACHE
+/*
+Opt-in cache of tokenize() results for scripts that are compiled again without changes.
+
+The file is <directory>/<hash>.tokens, where hash is hashBytes() of the source bytes seeded
+with COMPILER_VERSION and the ScanOptions, so editing the script, upgrading the compiler or
+scanning with other options picks a new file.
+It holds a header and then arrays (native byte order):
+
+    int64  number[tokens]   INT/TIME value
+    uint32 offset[tokens]
+    uint32 length[tokens]   lexeme length (with the quotes of STRING/TIME)
+    uint32 errorOffset[errors], errorLength[errors], errorTypeLength[errors], errorMessageLength[errors]
+    uint8  kind[tokens]
+    char   text[]           error types and messages, back to back
+
+A hit maps the file (SourceInput), checks the header against the source and rebuilds the
+token vector in one allocation: values are sliced from the source, nothing is scanned.
+A file that does not check out (bad size, kind, offset or text length) is a miss.
+Tokens come back without symbols, the Parser interns them as it reads them.
+*/
+
+// Bump when the scanner output changes, so old cache files are no longer found
+constexpr std::string_view COMPILER_VERSION = "video-compiler 1.3";
+
+// MurmurHash64A, 8 bytes per step
+uint64_t hashBytes(std::string_view data, uint64_t seed) {
+    const uint64_t M = 0xc6a4a7935bd1e995ULL;
+    const int R = 47;
+    uint64_t h = seed ^ (data.size() * M);
+    const char* p = data.data();
+    size_t blocks = data.size() / 8;
+    for (size_t k = 0; k < blocks; k++, p += 8) {
+        uint64_t word;
+        std::memcpy(&word, p, 8);
+        word *= M;
+        word ^= word >> R;
+        word *= M;
+        h ^= word;
+        h *= M;
+    }
+    size_t rest = data.size() & 7;
+    if (rest) {
+        uint64_t word = 0;
+        for (size_t k = 0; k < rest; k++) word |= static_cast<uint64_t>(static_cast<unsigned char>(p[k])) << (8 * k);
+        h ^= word;
+        h *= M;
+    }
+    h ^= h >> R;
+    h *= M;
+    h ^= h >> R;
+    return h;
+}
+
+class TokenCache {
+    struct Header {
+        char magic[4];
+        uint32_t format;
+        uint64_t sourceHash;
+        uint64_t sourceSize;
+        uint32_t tokenCount;
+        uint32_t errorCount;
+        uint64_t textSize;
+    };
+    static constexpr uint32_t FORMAT = 2;
+
+    std::string directory;
+    ScanOptions options;
+    size_t hitCount = 0;
+    size_t missCount = 0;
+
+    uint64_t sourceHash(std::string_view source) const {
+        uint64_t setting[2] = { options.errorLimit, static_cast<uint64_t>(options.frameRate) };
+        uint64_t seed = hashBytes(std::string_view(reinterpret_cast<const char*>(setting), sizeof(setting)),
+            hashBytes(COMPILER_VERSION, FORMAT));
+        return hashBytes(source, seed);
+    }
+    std::string pathFor(uint64_t hash) const {
+        char name[32];
+        std::snprintf(name, sizeof(name), "%016llx.tokens", static_cast<unsigned long long>(hash));
+        return (std::filesystem::path(directory) / name).string();
+    }
+    static size_t fileSize(const Header& header) {
+        return sizeof(Header) + header.tokenCount * (sizeof(int64_t) + 2 * sizeof(uint32_t) + 1)
+            + header.errorCount * 4 * sizeof(uint32_t) + header.textSize;
+    }
+    template <typename T>
+    static T at(const char* array, size_t index) {
+        T value;
+        std::memcpy(&value, array + index * sizeof(T), sizeof(T));
+        return value;
+    }
+
+    bool load(const std::string& path, std::string_view source, uint64_t hash,
+        std::vector<Token>& tokens, std::vector<ScannerError>& errors) const {
+        SourceInput file;
+        if (!file.open(path) || !file.isMapped()) return false;
+        std::string_view bytes = file.view();
+        Header header;
+        if (bytes.size() < sizeof(Header)) return false;
+        std::memcpy(&header, bytes.data(), sizeof(Header));
+        if (std::memcmp(header.magic, "VTKC", 4) != 0 || header.format != FORMAT || header.sourceHash != hash
+            || header.sourceSize != source.size() || bytes.size() != fileSize(header)) {
+            return false;
+        }
+
+        const char* numbers = bytes.data() + sizeof(Header);
+        const char* offsets = numbers + header.tokenCount * sizeof(int64_t);
+        const char* lengths = offsets + header.tokenCount * sizeof(uint32_t);
+        const char* errorOffsets = lengths + header.tokenCount * sizeof(uint32_t);
+        const char* errorLengths = errorOffsets + header.errorCount * sizeof(uint32_t);
+        const char* typeLengths = errorLengths + header.errorCount * sizeof(uint32_t);
+        const char* messageLengths = typeLengths + header.errorCount * sizeof(uint32_t);
+        const char* kinds = messageLengths + header.errorCount * sizeof(uint32_t);
+        const char* text = kinds + header.tokenCount;
+
+        tokens.resize(header.tokenCount);
+        for (size_t k = 0; k < header.tokenCount; k++) {
+            Token& token = tokens[k];
+            unsigned char kind = static_cast<unsigned char>(kinds[k]);
+            if (kind >= static_cast<unsigned char>(TokenType::END)) return false; // Corrupt file: a miss
+            token.type = static_cast<TokenType>(kind);
+            token.offset = at<uint32_t>(offsets, k);
+            token.number = at<int64_t>(numbers, k);
+            uint32_t length = at<uint32_t>(lengths, k);
+            bool quoted = token.type == TokenType::STRING || token.type == TokenType::TIME;
+            if (token.offset + static_cast<uint64_t>(length) > source.size() || (quoted && length < 2)) return false;
+            if (quoted) token.value = source.substr(token.offset + 1, length - 2);
+            else token.value = source.substr(token.offset, length);
+        }
+        size_t textUsed = 0;
+        for (size_t k = 0; k < header.errorCount; k++) {
+            uint32_t typeLength = at<uint32_t>(typeLengths, k);
+            uint32_t messageLength = at<uint32_t>(messageLengths, k);
+            if (textUsed + typeLength + messageLength > header.textSize) return false;
+            errors.push_back({ at<uint32_t>(errorOffsets, k), std::string(text + textUsed, typeLength),
+                std::string(text + textUsed + typeLength, messageLength), at<uint32_t>(errorLengths, k) });
+            textUsed += typeLength + messageLength;
+        }
+        return true;
+    }
+
+    // Written to a temporary name first, so a reader never sees half a file
+    void store(const std::string& path, std::string_view source, uint64_t hash,
+        const std::vector<Token>& tokens, const ScannerError* errors, size_t errorCount) const {
+        std::string text;
+        for (size_t k = 0; k < errorCount; k++) text += errors[k].type + errors[k].message;
+        Header header{ { 'V', 'T', 'K', 'C' }, FORMAT, hash, source.size(), static_cast<uint32_t>(tokens.size()),
+            static_cast<uint32_t>(errorCount), text.size() };
+
+        std::string data;
+        data.reserve(fileSize(header));
+        auto put = [&data](const auto& value) { data.append(reinterpret_cast<const char*>(&value), sizeof(value)); };
+        put(header);
+        for (const Token& token : tokens) put(token.number);
+        for (const Token& token : tokens) put(token.offset);
+        for (const Token& token : tokens) {
+            bool quoted = token.type == TokenType::STRING || token.type == TokenType::TIME;
+            put(static_cast<uint32_t>(token.value.size() + (quoted ? 2 : 0)));
+        }
+        for (size_t k = 0; k < errorCount; k++) put(errors[k].offset);
+        for (size_t k = 0; k < errorCount; k++) put(errors[k].length);
+        for (size_t k = 0; k < errorCount; k++) put(static_cast<uint32_t>(errors[k].type.size()));
+        for (size_t k = 0; k < errorCount; k++) put(static_cast<uint32_t>(errors[k].message.size()));
+        for (const Token& token : tokens) put(static_cast<uint8_t>(token.type));
+        data += text;
+
+        std::error_code error;
+        std::filesystem::create_directories(directory, error);
+        std::string temporary = path + ".tmp";
+        {
+            std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+            if (!out.write(data.data(), static_cast<std::streamsize>(data.size()))) return;
+        }
+        std::filesystem::rename(temporary, path, error);
+        if (error) std::filesystem::remove(temporary, error);
+    }
+
+public:
+    explicit TokenCache(std::string dir, const ScanOptions& options = {}) : directory(std::move(dir)), options(options) {}
+
+    // Same result as tokenize(source, errors, options); source must stay alive with the tokens
+    std::vector<Token> tokenize(std::string_view source, std::vector<ScannerError>& errors) {
+        uint64_t hash = sourceHash(source);
+        std::string path = pathFor(hash);
+        std::vector<Token> tokens;
+        size_t firstError = errors.size();
+        if (load(path, source, hash, tokens, errors)) {
+            hitCount++;
+            return tokens;
+        }
+        errors.resize(firstError);
+        missCount++;
+        Lexer lexer(source, errors);
+        lexer.setOptions(options);
+        tokens = ::tokenize(lexer);
+        store(path, source, hash, tokens, errors.data() + firstError, errors.size() - firstError);
+        return tokens;
+    }
+
+    size_t hits() const {
+        return hitCount;
+    }
+    size_t misses() const {
+        return missCount;
+    }
+};
@@ -0,0 +1,224 @@
+#pragma once
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <cstring>
+#include <charconv>
+#include <memory>
+#include <string_view>
+
+//TRACE
+/*
+Leveled output of the compiler stages ("INFO SCAN - ...", "DEBUG SCAN - ...").
+
+INFO   - start/end of every stage
+DEBUG  - every token found by the scanner
+TRACE  - every statement found by the parser
+
+The level is picked at run time with the VIDEO_TRACE environment variable (off, info,
+debug, trace; debug by default) or with tracer().setLevel(). VIDEO_TRACE_FORMAT=json
+writes one JSON object per line instead of text.
+
+Levels above TRACE_MAX_LEVEL are compiled out: the checks are constant false and the
+calls disappear. Release builds (NDEBUG) keep only INFO; -DTRACE_MAX_LEVEL=0 removes
+all of it.
+
+Records are written into one preallocated buffer of BUFFER_SIZE bytes that goes out in a
+single fwrite when it fills up, on flush() and at exit. Call flush() before writing to
+std::cout/std::cerr so the output keeps its order.
+*/
+
+enum class TraceLevel { OFF, INFO, DEBUG, TRACE };
+
+#ifndef TRACE_MAX_LEVEL
+#ifdef NDEBUG
+#define TRACE_MAX_LEVEL 1
+#else
+#define TRACE_MAX_LEVEL 3
+#endif
+#endif
+
+class Tracer {
+public:
+    static constexpr size_t BUFFER_SIZE = 256 * 1024;
+
+    // One line of output; text parts form the message, field()s are only written as JSON
+    class Record {
+        Tracer& tracer;
+        bool inMessage = true;
+    public:
+        Record(Tracer& t, TraceLevel level, std::string_view stage) : tracer(t) {
+            static const char* const NAMES[] = { "OFF", "INFO", "DEBUG", "TRACE" };
+            std::string_view name = NAMES[static_cast<int>(level)];
+            if (tracer.json) {
+                tracer.put("{\"level\":\"");
+                tracer.put(name);
+                tracer.put("\",\"stage\":\"");
+                tracer.put(stage);
+                tracer.put("\",\"message\":\"");
+            }
+            else {
+                tracer.put(name);
+                tracer.put(' ');
+                tracer.put(stage);
+                tracer.put(" - ");
+            }
+        }
+        ~Record() {
+            if (tracer.json) tracer.put(inMessage ? "\"}\n" : "}\n");
+            else tracer.put('\n');
+        }
+        Record(const Record&) = delete;
+        Record& operator=(const Record&) = delete;
+
+        Record& operator<<(std::string_view text) {
+            if (tracer.json) tracer.putEscaped(text);
+            else tracer.put(text);
+            return *this;
+        }
+        Record& operator<<(char c) {
+            return *this << std::string_view(&c, 1);
+        }
+        Record& operator<<(int64_t n) {
+            tracer.put(n);
+            return *this;
+        }
+        Record& operator<<(int n) {
+            return *this << static_cast<int64_t>(n);
+        }
+        Record& operator<<(size_t n) {
+            return *this << static_cast<int64_t>(n);
+        }
+        // Fields go after the whole message
+        Record& field(std::string_view key, std::string_view value) {
+            if (!tracer.json) return *this;
+            beginField(key);
+            tracer.put('"');
+            tracer.putEscaped(value);
+            tracer.put('"');
+            return *this;
+        }
+        Record& field(std::string_view key, int64_t value) {
+            if (!tracer.json) return *this;
+            beginField(key);
+            tracer.put(value);
+            return *this;
+        }
+    private:
+        void beginField(std::string_view key) {
+            tracer.put(inMessage ? "\",\"" : ",\"");
+            inMessage = false;
+            tracer.put(key);
+            tracer.put("\":");
+        }
+    };
+
+private:
+    std::unique_ptr<char[]> buffer;
+    size_t used = 0;
+    FILE* out = stdout;
+    TraceLevel level = TraceLevel::DEBUG;
+    bool json = false;
+
+    void put(std::string_view text) {
+        if (used + text.size() > BUFFER_SIZE) {
+            flush();
+            if (text.size() > BUFFER_SIZE) {
+                std::fwrite(text.data(), 1, text.size(), out);
+                return;
+            }
+        }
+        std::memcpy(buffer.get() + used, text.data(), text.size());
+        used += text.size();
+    }
+    void put(char c) {
+        if (used == BUFFER_SIZE) flush();
+        buffer[used++] = c;
+    }
+    void put(int64_t n) {
+        char digits[24];
+        char* end = std::to_chars(digits, digits + sizeof(digits), n).ptr;
+        put(std::string_view(digits, end - digits));
+    }
+    void putEscaped(std::string_view text) {
+        size_t from = 0;
+        for (size_t k = 0; k < text.size(); k++) {
+            unsigned char c = static_cast<unsigned char>(text[k]);
+            if (c >= 0x20 && c != '"' && c != '\\') continue;
+            put(text.substr(from, k - from));
+            from = k + 1;
+            if (c == '"' || c == '\\') {
+                put('\\');
+                put(static_cast<char>(c));
+            }
+            else if (c == '\n') put("\\n");
+            else if (c == '\t') put("\\t");
+            else if (c == '\r') put("\\r");
+            else {
+                const char* HEX = "0123456789abcdef";
+                char escape[] = { '\\', 'u', '0', '0', HEX[c >> 4], HEX[c & 15] };
+                put(std::string_view(escape, sizeof(escape)));
+            }
+        }
+        put(text.substr(from));
+    }
+
+public:
+    // Level and format come from VIDEO_TRACE and VIDEO_TRACE_FORMAT
+    Tracer() : buffer(new char[BUFFER_SIZE]) {
+        if (const char* name = std::getenv("VIDEO_TRACE")) {
+            std::string_view value = name;
+            if (value == "off" || value == "OFF" || value == "0") level = TraceLevel::OFF;
+            else if (value == "info" || value == "INFO") level = TraceLevel::INFO;
+            else if (value == "debug" || value == "DEBUG") level = TraceLevel::DEBUG;
+            else if (value == "trace" || value == "TRACE") level = TraceLevel::TRACE;
+        }
+        if (const char* format = std::getenv("VIDEO_TRACE_FORMAT")) {
+            json = std::string_view(format) == "json";
+        }
+    }
+    ~Tracer() {
+        flush();
+    }
+    Tracer(const Tracer&) = delete;
+    Tracer& operator=(const Tracer&) = delete;
+
+    static constexpr bool compiled(TraceLevel l) {
+        return static_cast<int>(l) <= TRACE_MAX_LEVEL;
+    }
+    bool enabled(TraceLevel l) const {
+        return compiled(l) && l != TraceLevel::OFF && l <= level;
+    }
+    bool isJson() const {
+        return json;
+    }
+    void setLevel(TraceLevel l) {
+        level = l;
+    }
+    void setJson(bool on) {
+        json = on;
+    }
+    // Records already in the buffer go to the previous output
+    void setOutput(FILE* file) {
+        flush();
+        out = file;
+    }
+    void flush() {
+        if (used == 0) return;
+        std::fwrite(buffer.get(), 1, used, out);
+        std::fflush(out);
+        used = 0;
+    }
+
+    // Only call when enabled(level): tracer().record(...) << "text" << n;
+    Record record(TraceLevel l, std::string_view stage) {
+        return Record(*this, l, stage);
+    }
+};
+
+// Process-wide tracer, configured from the environment on first use
+Tracer& tracer() {
+    static Tracer instance;
+    return instance;
+}
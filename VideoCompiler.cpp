@@ -1,86 +1,113 @@
-
-#include "Parser.h"
-
-
-void read(std::string direc, std::string& out) {
-    std::ifstream file(direc);
-
-    if (!file.is_open()) {
-        std::cerr << "No se pudo abrir el archivo: " << direc << std::endl;
-        return;
-    }
-
-    std::stringstream buffer;
-    buffer << file.rdbuf(); // Lee todo el archivo de una vez
-    std::string line = buffer.str();
-    out = line;
-
-    scanAndLog(line);
-
-    file.close();
-}
-
-int main() {
-
-    /*
-    // PREVIOUS TESTS
-    std::string source;
-
-    read("C:/Users/alumno-m/Desktop/input.txt", source);
-
-    scanAndLog(source);
-    */
-    // --- TESTS ---
-
-    //NO ERRORS
-    std::string source0 = R"(
-    frame "video.mp4" 10 to "frame10.bmp";
-    concat "clip01.mp4" "clip02.mp4" to "output.mp4";
-    audio "clip01.mp4" "00:01" "00:05" to "audio.mp3";
-    play "output.mp4";
-    
-    )";
-    //ERROR Semicolon
-    std::string source1 = R"(
-    let start = "00:10"
-    frame "video.mp4" 5 to "frame5.bmp";
-    play "video.mp4";
-    )";
-    //ERROR Command
-    std::string source2 = R"(
-    let file = "video";
-    invalid "video.mp4"; # Unknown command
-    concat file + ".mp4" "clip2.mp4" to "output.mp4";
-    )";
-    //ERROR Expression
-    std::string source = R"(
-    let duration = "00:05";
-    audio "video.mp4" duration + + "00:10" to "audio.mp3"; # Invalid expression
-    if duration == "00:05" then play "video.mp4";
-    )";
-
-
-    std::vector<ScannerError> errors;
-    auto tokens = tokenize(source0, errors);
-    /*
-    for (const auto& token : tokens) {
-        std::cout << "Token: " << TokenTypeLiteral[(int)token.type] << " " << token.value << "\n";
-    }
-    */
-    //system("python generated_video_script.py");
-    std::cout << "----------------------" << "\n";
-    std::cout << "Token List size: " << tokens.size() << "\n";
-    std::cout << "----------------------" << "\n";
-    Parser parser(tokens);
-    try {
-        if (tokens.empty()) {
-            std::cerr << "Error: No tokens generated from the source code.\n";
-            return 1;
-        }
-        parser.parseAndExecute();
-    }
-    catch (const std::exception& e) {
-        std::cerr << e.what() << "\n";
-    }
-    return 0;
+
+#include "Pipeline.h"
+#include "TokenCache.h"
+
+
+// Opens the script ("-" for stdin) and scans it straight from the mapped file or the pipe
+bool read(const std::string& direc, SourceInput& input) {
+    if (!input.open(direc)) {
+        std::cerr << "No se pudo abrir el archivo: " << direc << std::endl;
+        return false;
+    }
+    return scanAndLog(input);
+}
+
+int main() {
+
+    /*
+    // PREVIOUS TESTS
+    SourceInput source;
+
+    read("C:/Users/alumno-m/Desktop/input.txt", source);
+
+    scanAndLog(source);
+    */
+    // --- TESTS ---
+
+    //NO ERRORS
+    std::string source0 = R"(
+    frame "video.mp4" 10 to "frame10.bmp";
+    concat "clip01.mp4" "clip02.mp4" to "output.mp4";
+    audio "clip01.mp4" "00:01" "00:05" to "audio.mp3";
+    play "output.mp4";
+    
+    )";
+    //ERROR Semicolon
+    std::string source1 = R"(
+    let start = "00:10"
+    frame "video.mp4" 5 to "frame5.bmp";
+    play "video.mp4";
+    )";
+    //ERROR Command
+    std::string source2 = R"(
+    let file = "video";
+    invalid "video.mp4"; # Unknown command
+    concat file + ".mp4" "clip2.mp4" to "output.mp4";
+    )";
+    //ERROR Expression
+    std::string source = R"(
+    let duration = "00:05";
+    audio "video.mp4" duration + + "00:10" to "audio.mp3"; # Invalid expression
+    if duration == "00:05" then play "video.mp4";
+    )";
+
+
+    std::vector<ScannerError> errors;
+    SymbolTable symbols;
+    std::vector<Token> tokens;
+    // VIDEO_FRAME_RATE=<fps> is the rate of HH:MM:SS:FF timecodes (TimePosition::DEFAULT_FRAME_RATE when unset)
+    ScanOptions options;
+    if (const char* frameRate = std::getenv("VIDEO_FRAME_RATE")) {
+        options.frameRate = std::atoll(frameRate);
+        if (options.frameRate <= 0) {
+            std::cerr << "Invalid VIDEO_FRAME_RATE: " << frameRate << "\n";
+            return 1;
+        }
+    }
+    // Nothing is generated, and the exit status is 1, when the scanner or the parser found an error
+    bool compiled = false;
+    // VIDEO_PIPELINE=1 scans on a second thread while the parser reads the tokens
+    if (std::getenv("VIDEO_PIPELINE")) {
+        try {
+            compiled = pipelined(source0, errors, [&errors](Parser& parser) { return parser.parseAndExecute(errors); },
+                PIPELINE_CAPACITY, options);
+        }
+        catch (const std::exception& e) {
+            std::cerr << e.what() << "\n";
+        }
+        return compiled ? 0 : 1;
+    }
+    // VIDEO_TOKEN_CACHE=<directory> reuses the tokens of an unchanged script
+    if (const char* cacheDirectory = std::getenv("VIDEO_TOKEN_CACHE")) {
+        TokenCache cache(cacheDirectory, options);
+        tokens = cache.tokenize(source0, errors);
+        if (tracer().enabled(TraceLevel::INFO)) {
+            tracer().record(TraceLevel::INFO, "CACHE") << cache.hits() << " hits, " << cache.misses() << " misses";
+        }
+        tracer().flush();
+    }
+    else {
+        tokens = tokenize(source0, errors, symbols, options);
+    }
+    /*
+    for (const auto& token : tokens) {
+        std::cout << "Token: " << TokenTypeLiteral[(int)token.type] << " " << token.value << "\n";
+    }
+    */
+    //system("python generated_video_script.py");
+    std::cout << "----------------------" << "\n";
+    std::cout << "Token List size: " << tokens.size() << "\n";
+    std::cout << "----------------------" << "\n";
+    Parser parser(tokens, source0, symbols);
+    try {
+        if (tokens.empty()) {
+            std::cerr << "Error: No tokens generated from the source code.\n";
+            return 1;
+        }
+        compiled = parser.parseAndExecute(errors);
+    }
+    catch (const std::exception& e) {
+        std::cerr << e.what() << "\n";
+    }
+    return compiled ? 0 : 1;
 }
\ No newline at end of file
@@ -0,0 +1,23 @@
+import ffmpeg
+import subprocess
+
+
+ffmpeg.input("v.mp4").filter("select", "eq(n\\,12)").output("o.bmp", vframes=1).run()
+
+if a == a:
+    subprocess.run(["vlc", "x.mp4", "--start-time", "1.000", "--stop-time", "2.000"])
+
+# Convert inputs
+ffmpeg.input("a.mp4").output("converted_0.mp4", vcodec='libx264', acodec='aac').run()
+ffmpeg.input("b.mp4").output("converted_1.mp4", vcodec='libx264', acodec='aac').run()
+
+# Write concat file list
+with open('files.txt', 'w') as f:
+    f.write("file 'converted_0.mp4'\n")
+    f.write("file 'converted_1.mp4'\n")
+
+# Concatenate with concat demuxer
+subprocess.run(['ffmpeg', '-f', 'concat', '-safe', '0', '-i', 'files.txt', '-c', 'copy', 'c.mp4'])
+
+ffmpeg.input("a.mp4", ss="00:00:01.000", to="a").output("q.mp3", vn=None, acodec='mp3').run()
+